@@ -1,4 +1,6 @@
 #include "bv.h"
+#include "bv_kernels.h"
+#include "bv_stats.h"
 
 #include <assert.h>
 #include <stddef.h>
@@ -49,33 +51,53 @@ static inline size_t no_words(size_t no_bits)
     return (no_bits + 63) / 64;
 }
 
-struct bv *bv_alloc(size_t no_bits)
+// The number of words that hold the bits [from, to).
+static inline size_t words_between(size_t from, size_t to)
+{
+    return from < to ? (to - 1) / 64 - from / 64 + 1 : 0;
+}
+
+size_t bv_size(size_t no_bits)
 {
     size_t header = offsetof(struct bv, data);
     size_t data = sizeof(uint64_t) * no_words(no_bits);
+    return header + data;
+}
+
+struct bv *bv_alloc(size_t no_bits)
+{
+    BV_STATS_SCOPE(ALLOC, no_words(no_bits));
     // Use calloc to satisfy static analysis.
     // It has the added benefit that all new vectors are 0-initialised.
-    struct bv *v = calloc(1, header + data);
+    struct bv *v = calloc(1, bv_size(no_bits));
     assert(v); // We don't handle allocation errors
+    BV_STATS_BYTES(bv_size(no_bits));
+    v->len = no_bits;
+    return v;
+}
+
+struct bv *bv_init(void *buf, size_t no_bits)
+{
+    BV_STATS_SCOPE(INIT, no_words(no_bits));
+    struct bv *v = buf;
     v->len = no_bits;
+    memset(v->data, 0, sizeof(uint64_t) * no_words(no_bits));
     return v;
 }
 
 struct bv *bv_new(size_t len)
 {
+    BV_STATS_SCOPE(NEW, no_words(len));
     return bv_alloc(len);
 }
 
 struct bv *bv_new_from_string(const char *str)
 {
+    BV_STATS_SCOPE(NEW_FROM_STRING, 0);
     size_t len = strlen(str); // FlawFinder: ignore (I know about '\0')
-    struct bv *v = bv_alloc(len);
-    for (size_t i = 0; *str; i++, str++)
-    {
-        // set to zero if *str == '0' and one otherwise
-        bv_set(v, i, *str != '0');
-    }
-    return v;
+    BV_STATS_WORDS(no_words(len));
+    // zero if *str == '0' and one otherwise
+    return bv_pack_text(bv_alloc(len), str);
 }
 
 // A vector is "dirty" if there are set bits in the last word, beyond the
@@ -87,35 +109,147 @@ static void bv_clean(struct bv *v)
     size_t k = v->len % 64;
     if (k != 0) // if k == 0 there are no extra bits.
     {
-        uint64_t mask = (1 << k) - 1;          // lower k words; we want to keep them.
-        v->data[no_words(v->len) - 1] &= mask; // remove the other bits.
+        uint64_t mask = ((uint64_t)1 << k) - 1; // lower k bits; we want to keep them.
+        v->data[no_words(v->len) - 1] &= mask;  // remove the other bits.
     }
 }
 
 struct bv *bv_copy(struct bv const *v)
 {
-    struct bv *w = bv_alloc(v->len);
-    EACH_WORD(v, WORD(w) = WORD(v));
-    return w;
+    BV_STATS_SCOPE(COPY, NWORDS(v));
+    return bv_copy_into(bv_alloc(v->len), v);
+}
+
+struct bv *bv_copy_into(struct bv *dst, struct bv const *v)
+{
+    BV_STATS_SCOPE(COPY_INTO, NWORDS(v));
+    assert(dst->len == v->len);
+    bv_kernels.copy_words(dst->data, v->data, NWORDS(v));
+    return dst;
+}
+
+// MARK: Arenas
+struct bv_arena_block
+{
+    struct bv_arena_block *next;
+    size_t size, used;
+    unsigned char mem[];
+};
+
+struct bv_arena
+{
+    size_t block_size;
+    struct bv_arena_block *blocks;  // all the blocks...
+    struct bv_arena_block *current; // ...and the one we allocate from
+};
+
+#define ARENA_DEFAULT_BLOCK ((size_t)1 << 20)
+
+struct bv_arena *bv_arena_new(size_t block_size)
+{
+    BV_STATS_SCOPE(ARENA_NEW, 0);
+    struct bv_arena *arena = malloc(sizeof *arena);
+    assert(arena); // We don't handle allocation errors
+    BV_STATS_BYTES(sizeof *arena);
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->blocks = arena->current = NULL;
+    return arena;
+}
+
+// Try to place a vector of `size` bytes in block b. We place it such that
+// its words, rather than the struct, start on a cache line.
+static struct bv *arena_place(struct bv_arena_block *b, size_t size)
+{
+    size_t header = offsetof(struct bv, data);
+    uintptr_t p = (uintptr_t)(b->mem + b->used);
+    uintptr_t aligned = ((p + header + 63) & ~(uintptr_t)63) - header;
+    size_t used = b->used + (aligned - p) + size;
+    if (used > b->size)
+        return NULL;
+    b->used = used;
+    return (struct bv *)aligned;
+}
+
+struct bv *bv_arena_alloc(struct bv_arena *arena, size_t len)
+{
+    BV_STATS_SCOPE(ARENA_ALLOC, no_words(len));
+    size_t size = bv_size(len);
+    struct bv *v = NULL;
+
+    // Use the current block, or blocks we kept from before a reset,
+    // and only allocate a new one if none of them has room.
+    while (arena->current && !(v = arena_place(arena->current, size)))
+    {
+        if (!arena->current->next)
+            break;
+        arena->current = arena->current->next;
+    }
+    if (!v)
+    {
+        size_t block_size = arena->block_size;
+        if (size + 64 > block_size)
+            block_size = size + 64; // room for the alignment as well
+        struct bv_arena_block *b = malloc(sizeof *b + block_size);
+        assert(b); // We don't handle allocation errors
+        BV_STATS_BYTES(sizeof *b + block_size);
+        b->next = NULL;
+        b->size = block_size;
+        b->used = 0;
+        if (arena->current)
+            arena->current->next = b;
+        else
+            arena->blocks = b;
+        arena->current = b;
+        v = arena_place(b, size);
+        assert(v);
+    }
+
+    return bv_init(v, len);
+}
+
+void bv_arena_reset(struct bv_arena *arena)
+{
+    BV_STATS_SCOPE(ARENA_RESET, 0);
+    for (struct bv_arena_block *b = arena->blocks; b; b = b->next)
+    {
+        b->used = 0;
+    }
+    arena->current = arena->blocks;
+}
+
+void bv_arena_free(struct bv_arena *arena)
+{
+    BV_STATS_SCOPE(ARENA_FREE, 0);
+    struct bv_arena_block *b = arena->blocks;
+    while (b)
+    {
+        struct bv_arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(arena);
 }
 
 // MARK Initialisation
 struct bv *bv_zero(struct bv *v)
 {
-    EACH_WORD(v, WORD(v) = (uint64_t)0);
+    BV_STATS_SCOPE(ZERO, NWORDS(v));
+    bv_kernels.fill_words(v->data, (uint64_t)0, NWORDS(v));
     return v;
 }
 
 struct bv *bv_one(struct bv *v)
 {
-    EACH_WORD(v, WORD(v) = ~(uint64_t)0);
+    BV_STATS_SCOPE(ONE, NWORDS(v));
+    bv_kernels.fill_words(v->data, ~(uint64_t)0, NWORDS(v));
     bv_clean(v); // Don't leave 1s in unused bits
     return v;
 }
 
 struct bv *bv_neg(struct bv *v)
 {
-    EACH_WORD(v, WORD(v) = ~WORD(v));
+    BV_STATS_SCOPE(NEG, NWORDS(v));
+    bv_kernels.not_words(v->data, v->data, NWORDS(v));
     bv_clean(v); // Don't leave 1s in unused bits
     return v;
 }
@@ -124,8 +258,11 @@ struct bv *bv_neg(struct bv *v)
 
 struct bv *bv_shift_up(struct bv *v, size_t m)
 {
+    BV_STATS_SCOPE(SHIFT_UP, NWORDS(v));
     size_t k = m % 64;
     size_t offset = m / 64;
+    if (offset > NWORDS(v))
+        offset = NWORDS(v); // everything is shifted out
 
     if (k == 0)
     {
@@ -155,8 +292,11 @@ struct bv *bv_shift_up(struct bv *v, size_t m)
 
 struct bv *bv_shift_down(struct bv *v, size_t m)
 {
+    BV_STATS_SCOPE(SHIFT_DOWN, NWORDS(v));
     size_t k = m % 64;
     size_t offset = m / 64;
+    if (offset > NWORDS(v))
+        offset = NWORDS(v); // everything is shifted out
 
     // From zero up to (n - offset) we shift and or to get the bit patterns.
     // clang-format off
@@ -176,76 +316,438 @@ struct bv *bv_shift_down(struct bv *v, size_t m)
     return v;
 }
 
+struct bv *bv_shift_up_or_assign(struct bv *v, size_t m, struct bv const *w)
+{
+    BV_STATS_SCOPE(SHIFT_UP_OR_ASSIGN, NWORDS(v));
+    assert(v->len == w->len);
+    size_t k = m % 64;
+    size_t offset = m / 64;
+    if (offset > NWORDS(v))
+        offset = NWORDS(v); // everything is shifted out
+
+    if (m == 0)
+    {
+        return bv_or_assign(v, w);
+    }
+    else if (m == 1)
+    {
+        // The SHIFT-and-OR case. Run forward and carry the top bit of each
+        // word into the next in a register, so we read and write each word
+        // just once.
+        uint64_t carry = 0;
+        EACH_WORD(v, {
+            uint64_t u = WORD(v);
+            WORD(v) = (u << 1) | carry | WORD(w);
+            carry = u >> 63;
+        })
+    }
+    else if (offset == 0)
+    {
+        // Same as above, just carrying k bits instead of one.
+        uint64_t carry = 0;
+        EACH_WORD(v, {
+            uint64_t u = WORD(v);
+            WORD(v) = (u << k) | carry | WORD(w);
+            carry = u >> (64 - k);
+        })
+    }
+    else
+    {
+        // Shifting by whole words means reading words we have already
+        // written if we go forward, so here we go through them in reverse
+        // as bv_shift_up() does, and zero-fill the lowest words with w.
+        // clang-format off
+        EACH_WORD_REV_TO(v, offset, {
+            uint64_t u = WORD_BEFORE(v, offset + 1);
+            uint64_t x = WORD_BEFORE(v, offset);
+            WORD(v) = RSHIFT(u, 64 - k) | LSHIFT(x, k) | WORD(w);
+        })
+        // clang-format on
+        EACH_WORD_TO(v, offset, WORD(v) = WORD(w));
+    }
+
+    // w is clean, so only the bits we shifted beyond the end need cleaning
+    bv_clean(v);
+
+    return v;
+}
+
 struct bv *bv_or_assign(struct bv *v, struct bv const *w)
 {
+    BV_STATS_SCOPE(OR_ASSIGN, NWORDS(v));
     assert(v->len == w->len);
-    EACH_WORD(v, WORD(v) |= WORD(w));
+    bv_kernels.or_words(v->data, v->data, w->data, NWORDS(v));
     return v;
 }
 
 struct bv *bv_and_assign(struct bv *v, struct bv const *w)
 {
+    BV_STATS_SCOPE(AND_ASSIGN, NWORDS(v));
     assert(v->len == w->len);
-    EACH_WORD(v, WORD(v) &= WORD(w));
+    bv_kernels.and_words(v->data, v->data, w->data, NWORDS(v));
     return v;
 }
 
 struct bv *bv_or(struct bv const *v, struct bv const *w)
 {
-    assert(v->len == w->len);
-    struct bv *u = bv_alloc(v->len);
-    EACH_WORD(u, WORD(u) = WORD(v) | WORD(w));
-    return u;
+    BV_STATS_SCOPE(OR, NWORDS(v));
+    return bv_or_into(bv_alloc(v->len), v, w);
 }
 
 struct bv *bv_and(struct bv const *v, struct bv const *w)
 {
-    assert(v->len == w->len);
-    struct bv *u = bv_alloc(v->len);
-    EACH_WORD(u, WORD(u) = WORD(v) & WORD(w));
-    return u;
+    BV_STATS_SCOPE(AND, NWORDS(v));
+    return bv_and_into(bv_alloc(v->len), v, w);
+}
+
+struct bv *bv_or_into(struct bv *dst, struct bv const *v, struct bv const *w)
+{
+    BV_STATS_SCOPE(OR_INTO, NWORDS(dst));
+    assert(dst->len == v->len && v->len == w->len);
+    bv_kernels.or_words(dst->data, v->data, w->data, NWORDS(dst));
+    return dst;
+}
+
+struct bv *bv_and_into(struct bv *dst, struct bv const *v, struct bv const *w)
+{
+    BV_STATS_SCOPE(AND_INTO, NWORDS(dst));
+    assert(dst->len == v->len && v->len == w->len);
+    bv_kernels.and_words(dst->data, v->data, w->data, NWORDS(dst));
+    return dst;
 }
 
 bool bv_eq(struct bv const *v, struct bv const *w)
 {
+    BV_STATS_SCOPE(EQ, NWORDS(v));
     if (v->len != w->len)
         return false;
-    EACH_WORD(v, if (WORD(v) != WORD(w)) return false);
-    return true;
+    return bv_kernels.eq_words(v->data, w->data, NWORDS(v));
 }
 
-// MARK I/O
-void bv_print(struct bv const *v)
+// MARK: Ranges
+// The bits from bit k and up in a word, and the bits up to and including bit k.
+static inline uint64_t mask_from(size_t k) { return ~(uint64_t)0 << k; }
+static inline uint64_t mask_to(size_t k) { return ~(uint64_t)0 >> (63 - k); }
+
+enum range_op
 {
-    static const char *sep[] = {
-        " | ", " | ", " | ", " |\n | "};
-    uint64_t w;
-    printf(" | ");
-    for (size_t i = 0; i < v->len; i++)
+    RANGE_SET,
+    RANGE_CLEAR,
+    RANGE_FLIP,
+};
+
+static inline void apply_mask(uint64_t *w, uint64_t mask, enum range_op op)
+{
+    switch (op)
     {
-        if (i % 64 == 0)
+    case RANGE_SET:
+        *w |= mask;
+        break;
+    case RANGE_CLEAR:
+        *w &= ~mask;
+        break;
+    case RANGE_FLIP:
+        *w ^= mask;
+        break;
+    }
+}
+
+// The partial words at the ends get masks, the whole words between them go
+// to the kernels.
+static struct bv *range_apply(struct bv *v, size_t from, size_t to, enum range_op op)
+{
+    assert(from <= to && to <= v->len);
+    if (from == to)
+        return v;
+
+    size_t first = from / 64, last = (to - 1) / 64;
+    uint64_t first_mask = mask_from(from % 64), last_mask = mask_to((to - 1) % 64);
+    if (first == last)
+    {
+        apply_mask(&v->data[first], first_mask & last_mask, op);
+        return v;
+    }
+
+    apply_mask(&v->data[first], first_mask, op);
+    uint64_t *middle = v->data + first + 1;
+    size_t n = last - first - 1;
+    switch (op)
+    {
+    case RANGE_SET:
+        bv_kernels.fill_words(middle, ~(uint64_t)0, n);
+        break;
+    case RANGE_CLEAR:
+        bv_kernels.fill_words(middle, (uint64_t)0, n);
+        break;
+    case RANGE_FLIP:
+        bv_kernels.not_words(middle, middle, n);
+        break;
+    }
+    apply_mask(&v->data[last], last_mask, op);
+
+    return v;
+}
+
+struct bv *bv_set_range(struct bv *v, size_t from, size_t to)
+{
+    BV_STATS_SCOPE(SET_RANGE, words_between(from, to));
+    return range_apply(v, from, to, RANGE_SET);
+}
+
+struct bv *bv_clear_range(struct bv *v, size_t from, size_t to)
+{
+    BV_STATS_SCOPE(CLEAR_RANGE, words_between(from, to));
+    return range_apply(v, from, to, RANGE_CLEAR);
+}
+
+struct bv *bv_flip_range(struct bv *v, size_t from, size_t to)
+{
+    BV_STATS_SCOPE(FLIP_RANGE, words_between(from, to));
+    return range_apply(v, from, to, RANGE_FLIP);
+}
+
+size_t bv_count_range(struct bv const *v, size_t from, size_t to)
+{
+    BV_STATS_SCOPE(COUNT_RANGE, words_between(from, to));
+    assert(from <= to && to <= v->len);
+    if (from == to)
+        return 0;
+
+    size_t first = from / 64, last = (to - 1) / 64;
+    uint64_t first_mask = mask_from(from % 64), last_mask = mask_to((to - 1) % 64);
+    if (first == last)
+        return (size_t)__builtin_popcountll(v->data[first] & first_mask & last_mask);
+
+    size_t count = (size_t)__builtin_popcountll(v->data[first] & first_mask);
+    count += bv_kernels.count_words(v->data + first + 1, last - first - 1);
+    count += (size_t)__builtin_popcountll(v->data[last] & last_mask);
+    return count;
+}
+
+size_t bv_count(struct bv const *v)
+{
+    BV_STATS_SCOPE(COUNT, NWORDS(v));
+    // The bits beyond the end are zero, so we can count whole words.
+    return bv_kernels.count_words(v->data, NWORDS(v));
+}
+
+// MARK: Finding bits
+// The first bit at or after i of the words, flipped if we look for zeros.
+// Past the end of the vector, the flipped words are ones, so we check the
+// result against the length.
+static inline size_t find_next(struct bv const *v, size_t i, uint64_t flip)
+{
+    if (i >= v->len)
+        return v->len;
+    size_t w = i / 64;
+    uint64_t word = (v->data[w] ^ flip) & mask_from(i % 64);
+    while (!word)
+    {
+        if (++w == NWORDS(v))
+            return v->len;
+        word = v->data[w] ^ flip;
+    }
+    size_t j = 64 * w + (size_t)__builtin_ctzll(word);
+    return j < v->len ? j : v->len;
+}
+
+// The words find_next() reads to find j, looking from i.
+static inline size_t words_scanned(struct bv const *v, size_t i, size_t j)
+{
+    return words_between(i, j < v->len ? j + 1 : v->len);
+}
+
+size_t bv_find_first(struct bv const *v)
+{
+    BV_STATS_SCOPE(FIND_FIRST, 0);
+    size_t j = find_next(v, 0, 0);
+    BV_STATS_WORDS(words_scanned(v, 0, j));
+    return j;
+}
+
+size_t bv_find_next(struct bv const *v, size_t i)
+{
+    BV_STATS_SCOPE(FIND_NEXT, 0);
+    size_t j = find_next(v, i, 0);
+    BV_STATS_WORDS(words_scanned(v, i, j));
+    return j;
+}
+
+size_t bv_find_first_zero(struct bv const *v)
+{
+    BV_STATS_SCOPE(FIND_FIRST_ZERO, 0);
+    size_t j = find_next(v, 0, ~(uint64_t)0);
+    BV_STATS_WORDS(words_scanned(v, 0, j));
+    return j;
+}
+
+size_t bv_find_next_zero(struct bv const *v, size_t i)
+{
+    BV_STATS_SCOPE(FIND_NEXT_ZERO, 0);
+    size_t j = find_next(v, i, ~(uint64_t)0);
+    BV_STATS_WORDS(words_scanned(v, i, j));
+    return j;
+}
+
+size_t bv_positions(struct bv const *v, size_t *from, size_t *pos, size_t max)
+{
+    BV_STATS_SCOPE(POSITIONS, 0);
+    if (*from >= v->len || max == 0)
+        return 0;
+
+    size_t n = 0, w = *from / 64;
+    uint64_t word = v->data[w] & mask_from(*from % 64);
+    for (;;)
+    {
+        // Clear the lowest one until the word is empty, so the cost is
+        // per one, not per bit.
+        for (; word; word &= word - 1)
         {
-            // Fetch next word
-            w = v->data[i / 64];
+            pos[n++] = 64 * w + (size_t)__builtin_ctzll(word);
+            if (n == max)
+            {
+                BV_STATS_WORDS(w + 1 - *from / 64);
+                *from = pos[n - 1] + 1;
+                return n;
+            }
         }
-        // Get the next bit and shift the word to get to the
-        // one after that
-        bool bit = w & 1;
-        w >>= 1;
+        if (++w == NWORDS(v))
+            break;
+        word = v->data[w];
+    }
+    BV_STATS_WORDS(w - *from / 64);
+    *from = v->len;
+    return n;
+}
+
+// The 64 bits of v from bit i, with zeros for bits beyond the last word.
+static inline uint64_t bits_at(struct bv const *v, size_t i)
+{
+    size_t w = i / 64, k = i % 64;
+    uint64_t lo = v->data[w] >> k;
+    uint64_t hi = (k && w + 1 < NWORDS(v)) ? v->data[w + 1] << (64 - k) : 0;
+    return lo | hi;
+}
 
-        // Print the bit
-        printf("%c", bit ? '1' : '.');
+// Copy `n` (at most 64, and within one word of dst) bits from src at
+// src_from into dst at dst_from.
+static inline void copy_piece(struct bv *dst, size_t dst_from,
+                              struct bv const *src, size_t src_from, size_t n)
+{
+    size_t k = dst_from % 64;
+    uint64_t mask = mask_from(k) & mask_to(k + n - 1);
+    uint64_t *w = &dst->data[dst_from / 64];
+    *w = (*w & ~mask) | ((bits_at(src, src_from) << k) & mask);
+}
 
-        if ((i + 1) % 16 == 0)
+struct bv *bv_copy_bits(struct bv *dst, size_t dst_from,
+                        struct bv const *src, size_t src_from, size_t n)
+{
+    BV_STATS_SCOPE(COPY_BITS, words_between(dst_from, dst_from + n));
+    assert(dst_from <= dst->len && n <= dst->len - dst_from);
+    assert(src_from <= src->len && n <= src->len - src_from);
+
+    // We write dst a word at a time, reading the source bits for each word
+    // across (at most) two source words. If the ranges overlap with the
+    // destination above the source, going forward would overwrite bits
+    // before we read them, so then we go backwards, like memmove().
+    if (dst_from <= src_from)
+    {
+        for (size_t done = 0; done < n;)
+        {
+            size_t d = dst_from + done;
+            size_t piece = 64 - d % 64;
+            if (piece > n - done)
+                piece = n - done;
+            copy_piece(dst, d, src, src_from + done, piece);
+            done += piece;
+        }
+    }
+    else
+    {
+        for (size_t end = dst_from + n; end > dst_from;)
         {
-            // Print a separator (between each 16 bits)
-            printf("%s", sep[(i / 16) % 4]);
+            size_t d = (end - 1) / 64 * 64;
+            if (d < dst_from)
+                d = dst_from;
+            copy_piece(dst, d, src, src_from + (d - dst_from), end - d);
+            end = d;
         }
     }
+
+    return dst;
+}
+
+// MARK I/O
+void bv_print(struct bv const *v)
+{
+    BV_STATS_SCOPE(PRINT, NWORDS(v));
+    static const char *sep[] = {
+        " | ", " | ", " | ", " |\n | "};
+    char *bits = malloc(v->len + 1);
+    assert(bits); // We don't handle allocation errors
+    BV_STATS_BYTES(v->len + 1);
+    bv_format(v, bits, '.', '1');
+
+    // The bits in blocks of 16, with a separator after each block
+    printf(" | ");
+    size_t i = 0;
+    for (; i + 16 <= v->len; i += 16)
+    {
+        fwrite(bits + i, 1, 16, stdout);
+        fputs(sep[(i / 16) % 4], stdout);
+    }
+    fwrite(bits + i, 1, v->len - i, stdout);
     // Pad the last block with spaces.
-    for (size_t i = v->len % 16; i < 16; i++)
+    printf("%*s |\n", (int)(16 - v->len % 16), "");
+
+    free(bits);
+}
+
+struct bv *bv_pack_bytes(struct bv *v, unsigned char const *bytes)
+{
+    BV_STATS_SCOPE(PACK_BYTES, NWORDS(v));
+    bv_kernels.pack_bytes(v->data, bytes, v->len, 0);
+    return v;
+}
+
+struct bv *bv_pack_text(struct bv *v, const char *text)
+{
+    BV_STATS_SCOPE(PACK_TEXT, NWORDS(v));
+    bv_kernels.pack_bytes(v->data, (unsigned char const *)text, v->len, '0');
+    return v;
+}
+
+void bv_unpack_bytes(struct bv const *v, unsigned char *bytes)
+{
+    BV_STATS_SCOPE(UNPACK_BYTES, NWORDS(v));
+    bv_kernels.unpack_bytes(bytes, v->data, v->len, 0, 1);
+}
+
+char *bv_format(struct bv const *v, char *buf, char zero, char one)
+{
+    BV_STATS_SCOPE(FORMAT, NWORDS(v));
+    bv_kernels.unpack_bytes((unsigned char *)buf, v->data, v->len,
+                            (unsigned char)zero, (unsigned char)one);
+    buf[v->len] = '\0';
+    return buf;
+}
+
+char *bv_format_hex(struct bv const *v, char *buf)
+{
+    BV_STATS_SCOPE(FORMAT_HEX, NWORDS(v));
+    static const char digits[] = "0123456789abcdef";
+    size_t n = (v->len + 3) / 4;
+    for (size_t i = 0; i < n; i += 16)
     {
-        printf(" ");
+        // A word at a time; the bits beyond the end are clean, so the
+        // last digit needs no masking.
+        uint64_t w = v->data[i / 16];
+        for (size_t j = i; j < i + 16 && j < n; j++, w >>= 4)
+        {
+            buf[j] = digits[w & 0xf];
+        }
     }
-    printf(" |\n");
+    buf[n] = '\0';
+    return buf;
 }
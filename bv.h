@@ -20,7 +20,7 @@ static inline size_t bv_widx(size_t i) { return i / 64; }
 static inline size_t bv_bidx(size_t i) { return i % 64; }
 // clang-format on
 
-static inline bool bv_get(struct bv *v, size_t i)
+static inline bool bv_get(struct bv const *v, size_t i)
 {
     uint64_t w = v->data[bv_widx(i)];           // Get the word
     return !!((uint64_t)1 & (w >> bv_bidx(i))); // shift the bit down and extract it
@@ -43,6 +43,23 @@ struct bv *bv_new(size_t len);                  // new vector all zeros
 struct bv *bv_new_from_string(const char *str); // vector spec on form "011010..."
 struct bv *bv_copy(struct bv const *v);
 
+// Vectors in memory you manage yourself: bv_size() is the number of bytes a
+// vector of length len needs, and bv_init() sets up an all-zero vector in
+// buf, which must be at least that large and aligned for uint64_t.
+size_t bv_size(size_t len);
+struct bv *bv_init(void *buf, size_t len);
+
+// An arena places vectors one after another in large blocks, so a batch of
+// vectors is contiguous in memory and costs a malloc() per block rather
+// than per vector. The vectors live until the arena is reset or freed;
+// don't free() them individually. block_size is the size of the blocks in
+// bytes (0 for a default of 1 MiB); larger vectors get a block of their own.
+struct bv_arena;
+struct bv_arena *bv_arena_new(size_t block_size);
+struct bv *bv_arena_alloc(struct bv_arena *arena, size_t len); // all zeros
+void bv_arena_reset(struct bv_arena *arena); // forget all vectors, keep the memory
+void bv_arena_free(struct bv_arena *arena);
+
 // These just return the modified input vector. They return it
 // so we can chain operations. NOTE: It is *not* a copy they return
 // so be careful with using these in expressions! They have side-effects.
@@ -53,6 +70,9 @@ struct bv *bv_neg(struct bv *v);
 struct bv *bv_shift_up(struct bv *v, size_t k);   // v =<< k
 struct bv *bv_shift_down(struct bv *v, size_t k); // v =>> k
 
+// v = (v << k) | w in a single pass over the words.
+struct bv *bv_shift_up_or_assign(struct bv *v, size_t k, struct bv const *w);
+
 struct bv *bv_or_assign(struct bv *v, struct bv const *w);  // v |= w
 struct bv *bv_and_assign(struct bv *v, struct bv const *w); // v &= w
 
@@ -60,8 +80,75 @@ struct bv *bv_and_assign(struct bv *v, struct bv const *w); // v &= w
 struct bv *bv_or(struct bv const *v, struct bv const *w);  // v | w
 struct bv *bv_and(struct bv const *v, struct bv const *w); // v & w
 
+// These write the result into an existing vector of the same length and
+// return it, so they don't allocate. dst may be one of the operands.
+struct bv *bv_copy_into(struct bv *dst, struct bv const *v);                  // dst = v
+struct bv *bv_or_into(struct bv *dst, struct bv const *v, struct bv const *w);  // dst = v | w
+struct bv *bv_and_into(struct bv *dst, struct bv const *v, struct bv const *w); // dst = v & w
+
 bool bv_eq(struct bv const *v, struct bv const *w); // v == w
 
+// Operations on the bits [from, to) of v, a word at a time rather than a
+// bit at a time. Like the operations above they return the vector.
+struct bv *bv_set_range(struct bv *v, size_t from, size_t to);
+struct bv *bv_clear_range(struct bv *v, size_t from, size_t to);
+struct bv *bv_flip_range(struct bv *v, size_t from, size_t to);
+size_t bv_count_range(struct bv const *v, size_t from, size_t to); // number of ones
+size_t bv_count(struct bv const *v);                               // number of ones
+
+// The position of the first one (or zero) at or after i, or v->len if there
+// is none, a word at a time. To visit all the ones:
+//
+//     for (size_t i = bv_find_first(v); i < v->len; i = bv_find_next(v, i + 1))
+size_t bv_find_first(struct bv const *v);
+size_t bv_find_next(struct bv const *v, size_t i);
+size_t bv_find_first_zero(struct bv const *v);
+size_t bv_find_next_zero(struct bv const *v, size_t i);
+
+// Write the positions of up to max ones, from *from on, to pos, and return
+// how many it wrote. *from moves past the last one written, so we get all
+// of them in batches with
+//
+//     size_t pos[256], n, from = 0;
+//     while ((n = bv_positions(v, &from, pos, 256)) > 0)
+//         ...
+size_t bv_positions(struct bv const *v, size_t *from, size_t *pos, size_t max);
+
+// Copy the n bits of src from src_from to dst from dst_from, and return
+// dst. The vectors may be the same, and the ranges may overlap.
+struct bv *bv_copy_bits(struct bv *dst, size_t dst_from,
+                        struct bv const *src, size_t src_from, size_t n);
+
 void bv_print(struct bv const *v);
 
+// Conversion to and from one byte per bit, in bulk with SIMD. The pack
+// functions read v->len bytes; a bit is one unless its byte is 0 (for
+// bytes) or '0' (for text), like bv_new_from_string().
+struct bv *bv_pack_bytes(struct bv *v, unsigned char const *bytes);
+struct bv *bv_pack_text(struct bv *v, const char *text);
+void bv_unpack_bytes(struct bv const *v, unsigned char *bytes); // 0 or 1 per bit
+
+// Write v into buf, which must have room for the output and a terminating
+// '\0', and return buf. bv_format() writes a character per bit, zero or
+// one, so v->len + 1 bytes. bv_format_hex() writes a hex digit per four bits,
+// so (v->len + 3) / 4 + 1 bytes; each digit holds its bits with the first
+// as the least significant, and the digits come in the order of the bits.
+char *bv_format(struct bv const *v, char *buf, char zero, char one);
+char *bv_format_hex(struct bv const *v, char *buf);
+
+// The bulk operations above (copy, zero, one, neg, or, and, eq, count and
+// the conversions) run on SIMD kernels picked for the CPU when the library is
+// loaded. bv_isa_select() switches to a lower instruction set, e.g. for
+// testing or benchmarking, and returns the one actually picked (never more
+// than the CPU supports).
+enum bv_isa
+{
+    BV_ISA_SCALAR,
+    BV_ISA_SSE2,
+    BV_ISA_AVX2,
+    BV_ISA_AVX512,
+};
+enum bv_isa bv_isa(void);
+enum bv_isa bv_isa_select(enum bv_isa isa);
+
 #endif // BV_H
@@ -0,0 +1,74 @@
+#ifndef BV_ATOMIC_H
+#define BV_ATOMIC_H
+
+#include "bv.h"
+
+#include <stdatomic.h>
+
+// Bit vectors that several threads can update at the same time without
+// locks. bv_set() reads a whole word, changes a bit and writes the word
+// back, so two threads setting different bits in the same word can lose
+// each other's updates. Here every update is a single atomic fetch_or,
+// fetch_and or fetch_xor on the word, which also tells us what the bit was
+// before, so bv_atomic_test_and_set() works as a concurrent "visited" set.
+//
+// The layout is the same as struct bv, just with atomic words, so a vector
+// can be turned into an atomic one for a parallel phase and back again
+// afterwards, as long as nobody uses the plain vector in between. The
+// updates are acquire/release, so a thread that sees a bit set also sees
+// what the setting thread wrote before it.
+struct bv_atomic
+{
+    size_t len;
+    _Atomic uint64_t data[];
+};
+
+_Static_assert(sizeof(_Atomic uint64_t) == sizeof(uint64_t) &&
+                   _Alignof(_Atomic uint64_t) == _Alignof(uint64_t),
+               "atomic words must have the layout of plain words");
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "atomic words must be lock-free");
+
+// Free with free(), like any other vector.
+static inline struct bv_atomic *bv_atomic_new(size_t len)
+{
+    return (struct bv_atomic *)bv_new(len);
+}
+static inline struct bv_atomic *bv_atomic_from_bv(struct bv *v)
+{
+    return (struct bv_atomic *)v;
+}
+static inline struct bv *bv_atomic_to_bv(struct bv_atomic *v)
+{
+    return (struct bv *)v;
+}
+
+static inline bool bv_atomic_get(struct bv_atomic const *v, size_t i)
+{
+    uint64_t w = atomic_load_explicit(&v->data[bv_widx(i)], memory_order_acquire);
+    return !!((uint64_t)1 & (w >> bv_bidx(i)));
+}
+
+// These set, clear or flip bit i and return its previous value.
+static inline bool bv_atomic_set(struct bv_atomic *v, size_t i, bool b)
+{
+    uint64_t mask = (uint64_t)1 << bv_bidx(i);
+    uint64_t w = b ? atomic_fetch_or_explicit(&v->data[bv_widx(i)], mask, memory_order_acq_rel)
+                   : atomic_fetch_and_explicit(&v->data[bv_widx(i)], ~mask, memory_order_acq_rel);
+    return !!(w & mask);
+}
+static inline bool bv_atomic_flip(struct bv_atomic *v, size_t i)
+{
+    uint64_t mask = (uint64_t)1 << bv_bidx(i);
+    return !!(atomic_fetch_xor_explicit(&v->data[bv_widx(i)], mask, memory_order_acq_rel) & mask);
+}
+
+// Set bit i and return true if this call set it, i.e. if it was clear
+// before. Of several threads racing to set the same bit, exactly one wins.
+// We check the bit first, since a plain load is much cheaper than the
+// locked update when the bit is already set.
+static inline bool bv_atomic_test_and_set(struct bv_atomic *v, size_t i)
+{
+    return !bv_atomic_get(v, i) && !bv_atomic_set(v, i, true);
+}
+
+#endif // BV_ATOMIC_H
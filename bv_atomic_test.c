@@ -0,0 +1,145 @@
+#include "bv_atomic.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NO_THREADS 8
+#define LEN 100003
+
+static void test_single_thread(void)
+{
+    struct bv_atomic *v = bv_atomic_new(130);
+    for (size_t i = 0; i < v->len; i++)
+    {
+        assert(!bv_atomic_get(v, i));
+    }
+
+    bool old = bv_atomic_set(v, 64, true);
+    assert(!old);
+    old = bv_atomic_set(v, 64, true);
+    assert(old);
+    assert(bv_atomic_get(v, 64) && !bv_atomic_get(v, 63) && !bv_atomic_get(v, 65));
+    old = bv_atomic_set(v, 64, false);
+    assert(old);
+    old = bv_atomic_set(v, 64, false);
+    assert(!old);
+
+    old = bv_atomic_flip(v, 129);
+    assert(!old);
+    old = bv_atomic_flip(v, 129);
+    assert(old);
+    assert(!bv_atomic_get(v, 129));
+
+    bool won = bv_atomic_test_and_set(v, 7);
+    assert(won);
+    won = bv_atomic_test_and_set(v, 7);
+    assert(!won);
+    (void)old;
+    (void)won;
+
+    // The plain vector sees the same bits
+    struct bv *w = bv_atomic_to_bv(v);
+    for (size_t i = 0; i < w->len; i++)
+    {
+        assert(bv_get(w, i) == (i == 7));
+    }
+    assert(bv_atomic_from_bv(w) == v);
+
+    free(v);
+}
+
+struct worker
+{
+    struct bv_atomic *v;
+    size_t id;
+    size_t won; // number of bits this thread set first
+};
+
+// Each thread sets the bits i with i % (2 * NO_THREADS) == id and clears
+// those with i % (2 * NO_THREADS) == NO_THREADS + id, interleaved with the
+// other threads' bits so they all write to the same words.
+static void *set_interleaved(void *arg)
+{
+    struct worker *w = arg;
+    for (size_t i = w->id; i + NO_THREADS < w->v->len; i += 2 * NO_THREADS)
+    {
+        bv_atomic_set(w->v, i, true);
+        bv_atomic_set(w->v, i + NO_THREADS, false);
+    }
+    return NULL;
+}
+
+// All threads try to claim all bits.
+static void *claim_all(void *arg)
+{
+    struct worker *w = arg;
+    for (size_t i = 0; i < w->v->len; i++)
+    {
+        // Start at different places so the threads collide mid-way.
+        size_t j = (i + w->id * w->v->len / NO_THREADS) % w->v->len;
+        w->won += bv_atomic_test_and_set(w->v, j);
+    }
+    return NULL;
+}
+
+static void run_threads(struct bv_atomic *v, void *(*f)(void *), struct worker workers[NO_THREADS])
+{
+    pthread_t threads[NO_THREADS];
+    for (size_t t = 0; t < NO_THREADS; t++)
+    {
+        workers[t] = (struct worker){v, t, 0};
+        int err = pthread_create(&threads[t], NULL, f, &workers[t]);
+        assert(err == 0);
+        (void)err;
+    }
+    for (size_t t = 0; t < NO_THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+static void test_threads(void)
+{
+    struct worker workers[NO_THREADS];
+
+    // Start with the bits the threads clear set, and end with exactly
+    // the bits they set, if no update is lost.
+    size_t len = LEN / (2 * NO_THREADS) * (2 * NO_THREADS);
+    struct bv_atomic *v = bv_atomic_new(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        bv_set(bv_atomic_to_bv(v), i, i % (2 * NO_THREADS) >= NO_THREADS);
+    }
+    run_threads(v, set_interleaved, workers);
+    for (size_t i = 0; i < len; i++)
+    {
+        assert(bv_atomic_get(v, i) == (i % (2 * NO_THREADS) < NO_THREADS));
+    }
+    free(v);
+
+    v = bv_atomic_new(LEN);
+    run_threads(v, claim_all, workers);
+    size_t won = 0;
+    for (size_t t = 0; t < NO_THREADS; t++)
+    {
+        won += workers[t].won;
+    }
+    assert(won == LEN); // every bit claimed exactly once
+    for (size_t i = 0; i < LEN; i++)
+    {
+        assert(bv_atomic_get(v, i));
+    }
+    free(v);
+}
+
+int main(void)
+{
+    test_single_thread();
+    for (int round = 0; round < 10; round++)
+    {
+        test_threads();
+    }
+    return 0;
+}
@@ -0,0 +1,663 @@
+// Throughput benchmarks for the operations in bv.h and bv_par.h, across
+// vector sizes from L1 to DRAM, and for the SHIFT-and-OR inner loops of
+// sao (struct bv) and sao_raw (a single machine word) across pattern
+// lengths and alphabets.
+//
+// Each measurement is run a number of warm-up times and then timed a
+// number of times; we report the fastest and the median time per
+// operation, and the throughput of the fastest, as CSV or JSON. Build
+// with optimisation (e.g. -DCMAKE_BUILD_TYPE=Release) for useful numbers.
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bv.h"
+#include "bv_block.h"
+#include "bv_par.h"
+#include "bv_expr.h"
+#include "bv_ring.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
+#include "test_util.h"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Results we compute but don't use go here, so the compiler can't drop them.
+static volatile uint64_t sink;
+
+// MARK: Options and output
+enum format
+{
+    CSV,
+    JSON,
+};
+
+static struct
+{
+    enum format format;
+    unsigned reps, warmup;
+    size_t max_bytes;  // largest vector
+    size_t text_bytes; // length of the synthetic texts
+    const char *text_path;
+    unsigned threads;
+    enum bv_isa isa;
+} opt = {CSV, 5, 1, (size_t)64 << 20, (size_t)16 << 20, NULL, 0, BV_ISA_AVX512};
+
+static const char *isa_names[] = {"scalar", "sse2", "avx2", "avx512"};
+static bool first_row = true;
+
+static void report(const char *group, const char *op, const char *input,
+                   size_t bytes, const char *param, double ns_min, double ns_median)
+{
+    // bytes is what one operation touches, so bytes / ns is GB/s.
+    double gbps = bytes / ns_min;
+    if (opt.format == CSV)
+    {
+        if (first_row)
+            printf("group,op,input,bytes,param,isa,threads,reps,ns_min,ns_median,gb_per_s\n");
+        printf("%s,%s,%s,%zu,%s,%s,%u,%u,%.3f,%.3f,%.3f\n",
+               group, op, input, bytes, param, isa_names[bv_isa()], opt.threads,
+               opt.reps, ns_min, ns_median, gbps);
+    }
+    else
+    {
+        printf("%s  {\"group\": \"%s\", \"op\": \"%s\", \"input\": \"%s\", \"bytes\": %zu, "
+               "\"param\": \"%s\", \"isa\": \"%s\", \"threads\": %u, \"reps\": %u, "
+               "\"ns_min\": %.3f, \"ns_median\": %.3f, \"gb_per_s\": %.3f}",
+               first_row ? "[\n" : ",\n",
+               group, op, input, bytes, param, isa_names[bv_isa()], opt.threads,
+               opt.reps, ns_min, ns_median, gbps);
+    }
+    first_row = false;
+    fflush(stdout);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(double const *)a, y = *(double const *)b;
+    return (x > y) - (x < y);
+}
+
+// Run f(ctx) `iters` times per repetition, after the warm-up repetitions,
+// and get the fastest and median time per call.
+static void measure(void (*f)(void *ctx), void *ctx, size_t iters,
+                    double *ns_min, double *ns_median)
+{
+    double *times = malloc(opt.reps * sizeof *times);
+    assert(times);
+    for (unsigned r = 0; r < opt.warmup + opt.reps; r++)
+    {
+        double start = now_ns();
+        for (size_t i = 0; i < iters; i++)
+        {
+            f(ctx);
+        }
+        double t = (now_ns() - start) / iters;
+        if (r >= opt.warmup)
+            times[r - opt.warmup] = t;
+    }
+    qsort(times, opt.reps, sizeof *times, cmp_double);
+    *ns_min = times[0];
+    *ns_median = times[opt.reps / 2];
+    free(times);
+}
+
+// MARK: Vector operations
+struct op_ctx
+{
+    struct bv *v, *w, *u;
+    size_t *positions; // random bit positions for get/set
+    char *bytes;       // a byte per bit, for the conversions
+    char *string;      // v as '0's and '1's, for bv_new_from_string()
+    struct bv_ring *ring;
+    struct bv_expr *expr; // (a & b) | ~c over v, w, u
+    struct bv *t;         // scratch for the unfused version
+    struct bv *sparse;    // about one bit in 64 set
+    // v and w with other block widths
+    struct bvb32 *bvb32[2];
+    struct bvb64 *bvb64[2];
+#ifdef __SIZEOF_INT128__
+    struct bvb128 *bvb128[2];
+#endif
+    struct bvb256 *bvb256[2];
+};
+
+#define NO_POSITIONS 4096
+
+// clang-format off
+static void op_zero(void *c)        { bv_zero(((struct op_ctx *)c)->v); }
+static void op_one(void *c)         { bv_one(((struct op_ctx *)c)->v); }
+static void op_neg(void *c)         { bv_neg(((struct op_ctx *)c)->v); }
+static void op_copy_into(void *c)   { struct op_ctx *x = c; bv_copy_into(x->u, x->v); }
+static void op_new(void *c)         { free(bv_new(((struct op_ctx *)c)->v->len)); }
+static void op_copy(void *c)        { free(bv_copy(((struct op_ctx *)c)->v)); }
+static void op_or(void *c)          { struct op_ctx *x = c; free(bv_or(x->v, x->w)); }
+static void op_and(void *c)         { struct op_ctx *x = c; free(bv_and(x->v, x->w)); }
+static void op_or_assign(void *c)   { struct op_ctx *x = c; bv_or_assign(x->v, x->w); }
+static void op_and_assign(void *c)  { struct op_ctx *x = c; bv_and_assign(x->v, x->w); }
+static void op_or_into(void *c)     { struct op_ctx *x = c; bv_or_into(x->u, x->v, x->w); }
+static void op_and_into(void *c)    { struct op_ctx *x = c; bv_and_into(x->u, x->v, x->w); }
+static void op_eq(void *c)          { struct op_ctx *x = c; sink += bv_eq(x->v, x->w); }
+static void op_shift_up_1(void *c)  { bv_shift_up(((struct op_ctx *)c)->v, 1); }
+static void op_shift_up_71(void *c) { bv_shift_up(((struct op_ctx *)c)->v, 71); }
+static void op_shift_down_1(void *c) { bv_shift_down(((struct op_ctx *)c)->v, 1); }
+static void op_shift_down_71(void *c) { bv_shift_down(((struct op_ctx *)c)->v, 71); }
+static void op_shift_up_or_1(void *c) { struct op_ctx *x = c; bv_shift_up_or_assign(x->v, 1, x->w); }
+static void op_set_range(void *c)   { struct op_ctx *x = c; bv_set_range(x->v, 3, x->v->len - 5); }
+static void op_flip_range(void *c)  { struct op_ctx *x = c; bv_flip_range(x->v, 3, x->v->len - 5); }
+static void op_count_range(void *c) { struct op_ctx *x = c; sink += bv_count_range(x->v, 3, x->v->len - 5); }
+static void op_count(void *c)       { sink += bv_count(((struct op_ctx *)c)->v); }
+static void op_copy_bits(void *c)   { struct op_ctx *x = c; bv_copy_bits(x->u, 5, x->v, 3, x->v->len - 5); }
+static void op_par_neg(void *c)     { bv_par_neg(((struct op_ctx *)c)->v); }
+static void op_par_or_assign(void *c) { struct op_ctx *x = c; bv_par_or_assign(x->v, x->w); }
+static void op_par_and_assign(void *c) { struct op_ctx *x = c; bv_par_and_assign(x->v, x->w); }
+static void op_par_eq(void *c)      { struct op_ctx *x = c; sink += bv_par_eq(x->v, x->w); }
+static void op_par_shift_up_1(void *c) { bv_par_shift_up(((struct op_ctx *)c)->v, 1); }
+static void op_par_shift_down_71(void *c) { bv_par_shift_down(((struct op_ctx *)c)->v, 71); }
+static void op_pack_bytes(void *c)  { struct op_ctx *x = c; bv_pack_bytes(x->u, (unsigned char *)x->bytes); }
+static void op_unpack_bytes(void *c) { struct op_ctx *x = c; bv_unpack_bytes(x->v, (unsigned char *)x->bytes); }
+static void op_format(void *c)      { struct op_ctx *x = c; bv_format(x->v, x->bytes, '0', '1'); }
+static void op_format_hex(void *c)  { struct op_ctx *x = c; bv_format_hex(x->v, x->bytes); }
+static void op_new_from_string(void *c) { free(bv_new_from_string(((struct op_ctx *)c)->string)); }
+static void op_print(void *c)       { bv_print(((struct op_ctx *)c)->v); }
+static void op_ring_shift_up_1(void *c) { bv_ring_shift_up(((struct op_ctx *)c)->ring, 1); }
+static void op_ring_shift_up_or_1(void *c) { struct op_ctx *x = c; bv_ring_or_assign(bv_ring_shift_up(x->ring, 1), x->w); }
+static void op_expr_3(void *c)      { struct op_ctx *x = c; bv_expr_eval(x->expr, x->u, (struct bv const *[]){x->v, x->w, x->u}); }
+static void op_chain_3(void *c)     { struct op_ctx *x = c; bv_or_assign(bv_neg(x->u), bv_and_into(x->t, x->v, x->w)); }
+// clang-format on
+
+// The operations that depend on the block width, for each width.
+// clang-format off
+#define BLOCK_OPS(NAME)                                                                       \
+    static void op_##NAME##_or_assign(void *c) { struct op_ctx *x = c; NAME##_or_assign(x->NAME[0], x->NAME[1]); } \
+    static void op_##NAME##_shift_up_71(void *c) { NAME##_shift_up(((struct op_ctx *)c)->NAME[0], 71); } \
+    static void op_##NAME##_shift_up_or_1(void *c) { struct op_ctx *x = c; NAME##_shift_up_or_assign(x->NAME[0], 1, x->NAME[1]); } \
+    static void op_##NAME##_count(void *c) { sink += NAME##_count(((struct op_ctx *)c)->NAME[0]); }
+#define BLOCK_VECTOR_OPS(NAME)                                                           \
+    {.name = #NAME "_or_assign", .f = op_##NAME##_or_assign, .streams = 3},              \
+    {.name = #NAME "_shift_up_71", .f = op_##NAME##_shift_up_71, .streams = 2},          \
+    {.name = #NAME "_shift_up_or_assign_1", .f = op_##NAME##_shift_up_or_1, .streams = 3}, \
+    {.name = #NAME "_count", .f = op_##NAME##_count, .streams = 1},
+BLOCK_OPS(bvb32)
+BLOCK_OPS(bvb64)
+#ifdef __SIZEOF_INT128__
+BLOCK_OPS(bvb128)
+#endif
+BLOCK_OPS(bvb256)
+// clang-format on
+
+// All the ones of the sparse vector, in batches.
+static void op_positions(void *c)
+{
+    struct op_ctx *x = c;
+    size_t pos[256], n, from = 0;
+    while ((n = bv_positions(x->sparse, &from, pos, 256)) > 0)
+        sink += pos[n - 1];
+}
+
+// Random access is per bit, so one call does NO_POSITIONS of them.
+static void op_get(void *c)
+{
+    struct op_ctx *x = c;
+    uint64_t s = 0;
+    for (size_t i = 0; i < NO_POSITIONS; i++)
+    {
+        s += bv_get(x->v, x->positions[i]);
+    }
+    sink += s;
+}
+
+static void op_set(void *c)
+{
+    struct op_ctx *x = c;
+    for (size_t i = 0; i < NO_POSITIONS; i++)
+    {
+        bv_set(x->v, x->positions[i], i & 1);
+    }
+}
+
+// We report streams times the vector size as the bytes an operation
+// moves. For most rows that is the memory it reads and writes, but a few
+// are there to compare with another row, and report that row's work, so
+// their GB/s is equivalent-work throughput rather than bandwidth. The ring
+// shifts touch O(1) words but count as the struct bv shifts they replace,
+// chain_3 counts as the single pass of expr_3 that it does in three, and
+// the other block widths count as the struct bv operations of the same
+// names.
+struct vector_op
+{
+    const char *name;
+    void (*f)(void *ctx);
+    unsigned streams; // vectors read or written per operation (0 for per-bit ops)
+    bool bytes;       // needs a byte per bit, eight times the size of a vector
+    bool prints;      // writes to stdout, which we point at /dev/null meanwhile
+};
+
+static struct vector_op vector_ops[] = {
+    {.name = "zero", .f = op_zero, .streams = 1},
+    {.name = "one", .f = op_one, .streams = 1},
+    {.name = "neg", .f = op_neg, .streams = 2},
+    {.name = "copy_into", .f = op_copy_into, .streams = 2},
+    // calloc() may hand a large vector fresh pages that it never touches
+    {.name = "new", .f = op_new, .streams = 1},
+    {.name = "copy", .f = op_copy, .streams = 2},
+    {.name = "or_assign", .f = op_or_assign, .streams = 3},
+    {.name = "and_assign", .f = op_and_assign, .streams = 3},
+    {.name = "or_into", .f = op_or_into, .streams = 3},
+    {.name = "and_into", .f = op_and_into, .streams = 3},
+    {.name = "or", .f = op_or, .streams = 3},
+    {.name = "and", .f = op_and, .streams = 3},
+    {.name = "eq", .f = op_eq, .streams = 2},
+    {.name = "shift_up_1", .f = op_shift_up_1, .streams = 2},
+    {.name = "shift_up_71", .f = op_shift_up_71, .streams = 2},
+    {.name = "shift_down_1", .f = op_shift_down_1, .streams = 2},
+    {.name = "shift_down_71", .f = op_shift_down_71, .streams = 2},
+    {.name = "shift_up_or_assign_1", .f = op_shift_up_or_1, .streams = 3},
+    {.name = "ring_shift_up_1", .f = op_ring_shift_up_1, .streams = 2},
+    {.name = "ring_shift_up_or_assign_1", .f = op_ring_shift_up_or_1, .streams = 3},
+    {.name = "set_range", .f = op_set_range, .streams = 1},
+    {.name = "flip_range", .f = op_flip_range, .streams = 2},
+    {.name = "count_range", .f = op_count_range, .streams = 1},
+    {.name = "count", .f = op_count, .streams = 1},
+    {.name = "positions_sparse", .f = op_positions, .streams = 1}, // one bit in 64 set
+    {.name = "copy_bits", .f = op_copy_bits, .streams = 3},
+    {.name = "expr_3", .f = op_expr_3, .streams = 4},   // (a & b) | ~c in one pass
+    {.name = "chain_3", .f = op_chain_3, .streams = 4}, // the same in three passes
+    {.name = "get", .f = op_get, .streams = 0},
+    {.name = "set", .f = op_set, .streams = 0},
+    {.name = "pack_bytes", .f = op_pack_bytes, .streams = 9, .bytes = true},
+    {.name = "unpack_bytes", .f = op_unpack_bytes, .streams = 9, .bytes = true},
+    {.name = "format", .f = op_format, .streams = 9, .bytes = true},
+    {.name = "format_hex", .f = op_format_hex, .streams = 3, .bytes = true},
+    {.name = "new_from_string", .f = op_new_from_string, .streams = 9, .bytes = true},
+    {.name = "print", .f = op_print, .streams = 9, .bytes = true, .prints = true},
+    {.name = "par_neg", .f = op_par_neg, .streams = 2},
+    {.name = "par_or_assign", .f = op_par_or_assign, .streams = 3},
+    {.name = "par_and_assign", .f = op_par_and_assign, .streams = 3},
+    {.name = "par_eq", .f = op_par_eq, .streams = 2},
+    {.name = "par_shift_up_1", .f = op_par_shift_up_1, .streams = 2},
+    {.name = "par_shift_down_71", .f = op_par_shift_down_71, .streams = 2},
+    BLOCK_VECTOR_OPS(bvb32)
+    BLOCK_VECTOR_OPS(bvb64)
+#ifdef __SIZEOF_INT128__
+    BLOCK_VECTOR_OPS(bvb128)
+#endif
+    BLOCK_VECTOR_OPS(bvb256)
+};
+
+// bv_print() writes to stdout, where our results go, so we send it to
+// /dev/null while we time it.
+static int hide_stdout(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY); // FlawFinder: ignore
+    assert(saved >= 0 && null >= 0);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore_stdout(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+static void bench_vectors(void)
+{
+    // From a vector that fits in L1 to one that only fits in DRAM.
+    static const size_t sizes[] = {
+        (size_t)4 << 10, (size_t)32 << 10, (size_t)256 << 10,
+        (size_t)2 << 20, (size_t)16 << 20, (size_t)128 << 20, (size_t)1 << 30};
+
+    // Run the parallel operations in parallel whatever the size, so the
+    // numbers show where the threshold should be.
+    size_t old_threshold = bv_par_threshold(0);
+
+    size_t positions[NO_POSITIONS];
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes && sizes[s] <= opt.max_bytes; s++)
+    {
+        size_t bytes = sizes[s];
+        size_t len = 8 * bytes;
+        struct op_ctx ctx = {.v = random_vector(len), .w = random_vector(len),
+                             .u = bv_new(len), .positions = positions};
+        ctx.ring = bv_ring_from_bv(ctx.v);
+        ctx.expr = bv_expr_compile("(a & b) | ~c");
+        ctx.t = bv_new(len);
+        ctx.sparse = bv_new(len);
+        for (int i = 0; i < 2; i++)
+        {
+            struct bv const *x = i ? ctx.w : ctx.v;
+            ctx.bvb32[i] = bvb32_from_bv(x);
+            ctx.bvb64[i] = bvb64_from_bv(x);
+#ifdef __SIZEOF_INT128__
+            ctx.bvb128[i] = bvb128_from_bv(x);
+#endif
+            ctx.bvb256[i] = bvb256_from_bv(x);
+        }
+        for (size_t i = rng() % 64; i < len; i += 1 + rng() % 127)
+        {
+            bv_set(ctx.sparse, i, true);
+        }
+        // Skip the conversions when the byte array would be huge.
+        if (bytes <= ((size_t)16 << 20))
+        {
+            ctx.bytes = malloc(len + 1);
+            ctx.string = malloc(len + 1);
+            assert(ctx.bytes && ctx.string);
+            bv_format(ctx.v, ctx.bytes, 0, 1);
+            bv_format(ctx.v, ctx.string, '0', '1');
+        }
+        bv_copy_into(ctx.w, ctx.v); // equal vectors, so eq reads all of them
+        for (size_t i = 0; i < NO_POSITIONS; i++)
+        {
+            positions[i] = rng() % len;
+        }
+
+        // Enough calls per repetition to move about 256 MiB, so the small
+        // sizes aren't all timer resolution.
+        size_t iters = ((size_t)256 << 20) / bytes;
+        if (iters == 0)
+            iters = 1;
+
+        char input[32];
+        snprintf(input, sizeof input, "%zuKiB", bytes >> 10);
+        for (size_t i = 0; i < sizeof vector_ops / sizeof *vector_ops; i++)
+        {
+            struct vector_op const *op = &vector_ops[i];
+            double ns_min, ns_median;
+            if (op->bytes && !ctx.bytes)
+                continue;
+            if (op->streams)
+            {
+                if (op->prints)
+                {
+                    // A hundred times slower than the rest, so fewer calls.
+                    int saved = hide_stdout();
+                    measure(op->f, &ctx, 1 + iters / 64, &ns_min, &ns_median);
+                    restore_stdout(saved);
+                }
+                else
+                {
+                    measure(op->f, &ctx, iters, &ns_min, &ns_median);
+                }
+                report("vector", op->name, input, op->streams * bytes, "", ns_min, ns_median);
+            }
+            else
+            {
+                // Report these per bit access.
+                measure(op->f, &ctx, 1 + iters / 64, &ns_min, &ns_median);
+                report("vector", op->name, input, 0, "per_bit",
+                       ns_min / NO_POSITIONS, ns_median / NO_POSITIONS);
+            }
+        }
+
+        free(ctx.v);
+        free(ctx.w);
+        free(ctx.u);
+        free(ctx.bytes);
+        free(ctx.string);
+        free(ctx.ring);
+        bv_expr_free(ctx.expr);
+        free(ctx.t);
+        free(ctx.sparse);
+        for (int i = 0; i < 2; i++)
+        {
+            free(ctx.bvb32[i]);
+            free(ctx.bvb64[i]);
+#ifdef __SIZEOF_INT128__
+            free(ctx.bvb128[i]);
+#endif
+            free(ctx.bvb256[i]);
+        }
+    }
+
+    bv_par_threshold(old_threshold);
+}
+
+// MARK: Matching
+struct match_ctx
+{
+    const char *x;
+    size_t n, m;
+    const char *p;
+};
+
+// The inner loop of sao, on struct bv.
+static void match_sao(void *c)
+{
+    struct match_ctx *ctx = c;
+    struct bv **pmask = build_pattern_masks(ctx->m, ctx->p);
+    struct bv *match = bv_one(bv_new(ctx->m));
+    size_t count = 0;
+    for (size_t i = 0; i < ctx->n; i++)
+    {
+        bv_shift_up_or_assign(match, 1, pmask[(unsigned char)ctx->x[i]]);
+        count += !bv_get(match, ctx->m - 1);
+    }
+    sink += count;
+    free(match);
+    free_pattern_masks(pmask);
+}
+
+// The inner loop of sao_raw, on a single word (so m < 64).
+static void match_raw(void *c)
+{
+    struct match_ctx *ctx = c;
+    uint64_t pmask[sigma];
+    memset(pmask, 0xff, sizeof pmask);
+    for (size_t i = 0; i < ctx->m; i++)
+    {
+        pmask[(unsigned char)ctx->p[i]] &= ~((uint64_t)1 << i);
+    }
+    uint64_t match = ~(uint64_t)0, check_bit = (uint64_t)1 << (ctx->m - 1);
+    size_t count = 0;
+    for (size_t i = 0; i < ctx->n; i++)
+    {
+        match = (match << 1) | pmask[(unsigned char)ctx->x[i]];
+        count += !(match & check_bit);
+    }
+    sink += count;
+}
+
+static void bench_text(const char *input, const char *x, size_t n)
+{
+    static const size_t lengths[] = {4, 16, 32, 63, 64, 128, 256, 1024};
+    for (size_t l = 0; l < sizeof lengths / sizeof *lengths; l++)
+    {
+        size_t m = lengths[l];
+        if (m > n)
+            break;
+        // A pattern from the text, so there is at least one match.
+        struct match_ctx ctx = {x, n, m, x + rng() % (n - m + 1)};
+        char param[32];
+        snprintf(param, sizeof param, "m=%zu", m);
+
+        double ns_min, ns_median;
+        measure(match_sao, &ctx, 1, &ns_min, &ns_median);
+        report("match", "sao", input, n, param, ns_min, ns_median);
+        if (m < 64)
+        {
+            measure(match_raw, &ctx, 1, &ns_min, &ns_median);
+            report("match", "sao_raw", input, n, param, ns_min, ns_median);
+        }
+    }
+}
+
+static void bench_matching(void)
+{
+    // Synthetic texts over alphabets from binary to printable ASCII.
+    static const char *alphabets[] = {
+        "01", "ACGT", "ACDEFGHIKLMNPQRSTVWY",
+        " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"};
+    char *x = malloc(opt.text_bytes);
+    assert(x);
+    for (size_t a = 0; a < sizeof alphabets / sizeof *alphabets; a++)
+    {
+        size_t sigma_a = strlen(alphabets[a]); // FlawFinder: ignore
+        for (size_t i = 0; i < opt.text_bytes; i++)
+        {
+            x[i] = alphabets[a][rng() % sigma_a];
+        }
+        char input[32];
+        snprintf(input, sizeof input, "random_sigma%zu", sigma_a);
+        bench_text(input, x, opt.text_bytes);
+    }
+    free(x);
+
+    if (opt.text_path)
+    {
+        // Read the whole file into memory, so we time the matching and
+        // not the I/O.
+        struct sao_text text;
+        if (!sao_text_open(&text, opt.text_path))
+        {
+            perror(opt.text_path);
+            exit(1);
+        }
+        size_t n = 0, cap = 1 << 20;
+        char *buf = malloc(cap);
+        assert(buf);
+        const char *chunk;
+        for (size_t k; (k = sao_text_next(&text, &chunk)) > 0; n += k)
+        {
+            while (n + k > cap)
+            {
+                cap *= 2;
+                buf = realloc(buf, cap);
+                assert(buf);
+            }
+            memcpy(buf + n, chunk, k);
+        }
+        if (sao_text_failed(&text, opt.text_path))
+            exit(1);
+        sao_text_close(&text);
+        if (n > 0)
+            bench_text(opt.text_path, buf, n);
+        free(buf);
+    }
+}
+
+// MARK: Main
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] [vectors|matching]...\n"
+            "\n"
+            "Runs the vector and matching benchmarks (or the ones named) and\n"
+            "prints the results.\n"
+            "  -j          JSON output (default CSV)\n"
+            "  -r reps     timed repetitions per measurement (default %u)\n"
+            "  -w warmup   untimed repetitions first (default %u)\n"
+            "  -n bytes    largest vector size (default %zu)\n"
+            "  -l bytes    synthetic text length (default %zu)\n"
+            "  -x file     also match against the text in file\n"
+            "  -i isa      scalar, sse2, avx2 or avx512 (default the best)\n"
+            "  -t threads  threads for the parallel operations (default all cores)\n",
+            prog, opt.reps, opt.warmup, opt.max_bytes, opt.text_bytes);
+}
+
+static size_t parse_size(const char *s, const char *prog)
+{
+    char *end;
+    size_t n = strtoul(s, &end, 10);
+    if (*s == '\0' || *end != '\0')
+    {
+        usage(prog);
+        exit(1);
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    int c;
+    while ((c = getopt(argc, argv, "jr:w:n:l:x:i:t:")) != -1)
+    {
+        switch (c)
+        {
+        case 'j':
+            opt.format = JSON;
+            break;
+        case 'r':
+            opt.reps = (unsigned)parse_size(optarg, argv[0]);
+            break;
+        case 'w':
+            opt.warmup = (unsigned)parse_size(optarg, argv[0]);
+            break;
+        case 'n':
+            opt.max_bytes = parse_size(optarg, argv[0]);
+            break;
+        case 'l':
+            opt.text_bytes = parse_size(optarg, argv[0]);
+            break;
+        case 'x':
+            opt.text_path = optarg;
+            break;
+        case 'i':
+        {
+            size_t i = 0;
+            while (i < sizeof isa_names / sizeof *isa_names && strcmp(optarg, isa_names[i]))
+                i++;
+            if (i == sizeof isa_names / sizeof *isa_names)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            opt.isa = (enum bv_isa)i;
+            break;
+        }
+        case 't':
+            opt.threads = (unsigned)parse_size(optarg, argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.reps == 0 || opt.text_bytes == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bv_isa_select(opt.isa);
+    opt.threads = bv_par_threads(opt.threads);
+
+    bool vectors = optind == argc, matching = optind == argc;
+    for (int i = optind; i < argc; i++)
+    {
+        if (strcmp(argv[i], "vectors") == 0)
+            vectors = true;
+        else if (strcmp(argv[i], "matching") == 0)
+            matching = true;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (vectors)
+        bench_vectors();
+    if (matching)
+        bench_matching();
+
+    if (opt.format == JSON)
+        printf(first_row ? "[]\n" : "\n]\n");
+
+    return 0;
+}
@@ -0,0 +1,386 @@
+#ifndef BV_BLOCK_H
+#define BV_BLOCK_H
+
+// Bit vectors with the block type as a parameter: bvb32, bvb64, bvb128 and
+// bvb256 store their bits in uint32_t, uint64_t, unsigned __int128 and
+// 256-bit SIMD vector blocks, and otherwise have the same API.
+//
+// struct bv is built on 64-bit words, and the SIMD kernels, the rank
+// index, the file format and the matchers all rely on that. These are
+// separate types generated from one macro, so we can measure which block
+// width suits a workload, and use that one, without touching struct bv.
+// A wider block means fewer iterations per operation, but more work for
+// the operations that move bits between blocks, like the shifts.
+//
+// The macro expects these operations on a block, named after the type:
+//
+//     NAME_block_shl(x, k), NAME_block_shr(x, k)   x << k, x >> k, 0 < k < BITS
+//     NAME_block_bit(k)                             the block with bit k set
+//     NAME_block_is_zero(x)
+//     NAME_block_popcount(x)
+//     NAME_block_ctz(x)                             lowest one, x not zero
+//
+// and ~, &, | and ^ on blocks, as C has them for integers and GCC and
+// clang for vector types. As with struct bv, the bits beyond the length
+// are kept zero. Free the vectors with free().
+
+#include "bv.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// clang-format off
+#define BV_BLOCKS(NAME, BLOCK, BITS)                                             \
+    struct NAME                                                                  \
+    {                                                                            \
+        size_t len;                                                              \
+        BLOCK data[];                                                            \
+    };                                                                           \
+                                                                                 \
+    static inline size_t NAME##_no_blocks(size_t len)                            \
+    {                                                                            \
+        return (len + (BITS) - 1) / (BITS);                                      \
+    }                                                                            \
+                                                                                 \
+    /* Zero the bits beyond the end, which the shifts and neg can set. */        \
+    static inline void NAME##_clean(struct NAME *v)                              \
+    {                                                                            \
+        size_t k = v->len % (BITS);                                              \
+        if (k != 0)                                                              \
+            v->data[v->len / (BITS)] &= NAME##_block_shr(~(BLOCK){0}, (BITS) - k); \
+    }                                                                            \
+                                                                                 \
+    /* All zeros. The blocks may need more alignment than malloc() gives. */     \
+    static inline struct NAME *NAME##_new(size_t len)                            \
+    {                                                                            \
+        size_t align = _Alignof(struct NAME);                                    \
+        size_t size = offsetof(struct NAME, data) +                              \
+                      NAME##_no_blocks(len) * sizeof(BLOCK);                     \
+        struct NAME *v = aligned_alloc(align, (size + align - 1) / align * align); \
+        assert(v); /* We don't handle allocation errors */                       \
+        v->len = len;                                                            \
+        memset(v->data, 0, NAME##_no_blocks(len) * sizeof(BLOCK));               \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_copy(struct NAME const *v)                 \
+    {                                                                            \
+        struct NAME *u = NAME##_new(v->len);                                     \
+        memcpy(u->data, v->data, NAME##_no_blocks(v->len) * sizeof(BLOCK));      \
+        return u;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline bool NAME##_get(struct NAME const *v, size_t i)                \
+    {                                                                            \
+        BLOCK bit = NAME##_block_bit(i % (BITS));                                \
+        return !NAME##_block_is_zero(v->data[i / (BITS)] & bit);                 \
+    }                                                                            \
+    static inline struct NAME *NAME##_set(struct NAME *v, size_t i, bool b)      \
+    {                                                                            \
+        BLOCK bit = NAME##_block_bit(i % (BITS));                                \
+        if (b)                                                                   \
+            v->data[i / (BITS)] |= bit;                                          \
+        else                                                                     \
+            v->data[i / (BITS)] &= ~bit;                                         \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    /* Conversion to and from struct bv. On little-endian machines the bits  */ \
+    /* are in the same places in memory whatever the block, so we copy the   */ \
+    /* words; otherwise we go a bit at a time.                               */ \
+    static inline struct NAME *NAME##_from_bv(struct bv const *v)                \
+    {                                                                            \
+        struct NAME *u = NAME##_new(v->len);                                     \
+        if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)                           \
+            memcpy(u->data, v->data, (v->len + 7) / 8); /* whole bytes */       \
+        else                                                                     \
+            for (size_t i = 0; i < v->len; i++)                                  \
+                NAME##_set(u, i, bv_get(v, i));                                  \
+        return u;                                                                \
+    }                                                                            \
+    static inline struct bv *NAME##_to_bv(struct NAME const *v)                  \
+    {                                                                            \
+        struct bv *u = bv_new(v->len);                                           \
+        if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)                           \
+            memcpy(u->data, v->data, (v->len + 7) / 8); /* whole bytes */       \
+        else                                                                     \
+            for (size_t i = 0; i < v->len; i++)                                  \
+                bv_set(u, i, NAME##_get(v, i));                                  \
+        return u;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline struct NAME *NAME##_zero(struct NAME *v)                       \
+    {                                                                            \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            v->data[i] = (BLOCK){0};                                             \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_one(struct NAME *v)                        \
+    {                                                                            \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            v->data[i] = ~(BLOCK){0};                                            \
+        NAME##_clean(v);                                                         \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_neg(struct NAME *v)                        \
+    {                                                                            \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            v->data[i] = ~v->data[i];                                            \
+        NAME##_clean(v);                                                         \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline struct NAME *NAME##_or_assign(struct NAME *v, struct NAME const *w) \
+    {                                                                            \
+        assert(v->len == w->len);                                                \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            v->data[i] |= w->data[i];                                            \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_and_assign(struct NAME *v, struct NAME const *w) \
+    {                                                                            \
+        assert(v->len == w->len);                                                \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            v->data[i] &= w->data[i];                                            \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_or(struct NAME const *v, struct NAME const *w) \
+    {                                                                            \
+        return NAME##_or_assign(NAME##_copy(v), w);                              \
+    }                                                                            \
+    static inline struct NAME *NAME##_and(struct NAME const *v, struct NAME const *w) \
+    {                                                                            \
+        return NAME##_and_assign(NAME##_copy(v), w);                             \
+    }                                                                            \
+    static inline bool NAME##_eq(struct NAME const *v, struct NAME const *w)     \
+    {                                                                            \
+        if (v->len != w->len)                                                    \
+            return false;                                                        \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            if (!NAME##_block_is_zero(v->data[i] ^ w->data[i]))                  \
+                return false;                                                    \
+        return true;                                                             \
+    }                                                                            \
+                                                                                 \
+    /* v =<< k and v =>> k, for any k. */                                        \
+    static inline struct NAME *NAME##_shift_up(struct NAME *v, size_t k)         \
+    {                                                                            \
+        size_t n = NAME##_no_blocks(v->len), offset = k / (BITS), r = k % (BITS); \
+        if (offset > n)                                                          \
+            offset = n; /* everything is shifted out */                          \
+        for (size_t i = n; i-- > offset;)                                        \
+        {                                                                        \
+            BLOCK x = v->data[i - offset];                                       \
+            if (r)                                                               \
+            {                                                                    \
+                x = NAME##_block_shl(x, r);                                      \
+                if (i > offset)                                                  \
+                    x |= NAME##_block_shr(v->data[i - offset - 1], (BITS) - r);  \
+            }                                                                    \
+            v->data[i] = x;                                                      \
+        }                                                                        \
+        for (size_t i = 0; i < offset; i++)                                      \
+            v->data[i] = (BLOCK){0};                                             \
+        NAME##_clean(v);                                                         \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME *NAME##_shift_down(struct NAME *v, size_t k)       \
+    {                                                                            \
+        size_t n = NAME##_no_blocks(v->len), offset = k / (BITS), r = k % (BITS); \
+        if (offset > n)                                                          \
+            offset = n; /* everything is shifted out */                          \
+        for (size_t i = 0; i < n - offset; i++)                                  \
+        {                                                                        \
+            BLOCK x = v->data[i + offset];                                       \
+            if (r)                                                               \
+            {                                                                    \
+                x = NAME##_block_shr(x, r);                                      \
+                if (i + offset + 1 < n)                                          \
+                    x |= NAME##_block_shl(v->data[i + offset + 1], (BITS) - r);  \
+            }                                                                    \
+            v->data[i] = x;                                                      \
+        }                                                                        \
+        for (size_t i = n - offset; i < n; i++)                                  \
+            v->data[i] = (BLOCK){0};                                             \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    /* v = (v << k) | w. Within a block, in a single pass carrying the bits  */  \
+    /* that move into the next block; otherwise a shift and an or.           */  \
+    static inline struct NAME *NAME##_shift_up_or_assign(struct NAME *v, size_t k, \
+                                                         struct NAME const *w)   \
+    {                                                                            \
+        assert(v->len == w->len);                                                \
+        if (k == 0 || k >= (BITS))                                               \
+            return NAME##_or_assign(NAME##_shift_up(v, k), w);                   \
+        BLOCK carry = (BLOCK){0};                                                \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+        {                                                                        \
+            BLOCK x = v->data[i];                                                \
+            v->data[i] = NAME##_block_shl(x, k) | carry | w->data[i];            \
+            carry = NAME##_block_shr(x, (BITS) - k);                             \
+        }                                                                        \
+        NAME##_clean(v);                                                         \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline size_t NAME##_count(struct NAME const *v)                      \
+    {                                                                            \
+        size_t count = 0;                                                        \
+        for (size_t i = 0; i < NAME##_no_blocks(v->len); i++)                    \
+            count += NAME##_block_popcount(v->data[i]);                          \
+        return count;                                                            \
+    }                                                                            \
+    /* The first one at or after i, or v->len if there is none. */               \
+    static inline size_t NAME##_find_next(struct NAME const *v, size_t i)        \
+    {                                                                            \
+        if (i >= v->len)                                                         \
+            return v->len;                                                       \
+        size_t b = i / (BITS), r = i % (BITS);                                   \
+        BLOCK x = v->data[b];                                                    \
+        if (r)                                                                   \
+            x &= ~NAME##_block_shr(~(BLOCK){0}, (BITS) - r); /* bits from r up */ \
+        while (NAME##_block_is_zero(x))                                          \
+        {                                                                        \
+            if (++b == NAME##_no_blocks(v->len))                                 \
+                return v->len;                                                   \
+            x = v->data[b];                                                      \
+        }                                                                        \
+        return b * (BITS) + NAME##_block_ctz(x);                                 \
+    }                                                                            \
+    static inline size_t NAME##_find_first(struct NAME const *v)                 \
+    {                                                                            \
+        return NAME##_find_next(v, 0);                                           \
+    }
+// clang-format on
+
+// MARK: 32-bit blocks
+static inline uint32_t bvb32_block_shl(uint32_t x, size_t k) { return x << k; }
+static inline uint32_t bvb32_block_shr(uint32_t x, size_t k) { return x >> k; }
+static inline uint32_t bvb32_block_bit(size_t k) { return (uint32_t)1 << k; }
+static inline bool bvb32_block_is_zero(uint32_t x) { return x == 0; }
+static inline size_t bvb32_block_popcount(uint32_t x) { return (size_t)__builtin_popcount(x); }
+static inline size_t bvb32_block_ctz(uint32_t x) { return (size_t)__builtin_ctz(x); }
+BV_BLOCKS(bvb32, uint32_t, 32)
+
+// MARK: 64-bit blocks
+static inline uint64_t bvb64_block_shl(uint64_t x, size_t k) { return x << k; }
+static inline uint64_t bvb64_block_shr(uint64_t x, size_t k) { return x >> k; }
+static inline uint64_t bvb64_block_bit(size_t k) { return (uint64_t)1 << k; }
+static inline bool bvb64_block_is_zero(uint64_t x) { return x == 0; }
+static inline size_t bvb64_block_popcount(uint64_t x) { return (size_t)__builtin_popcountll(x); }
+static inline size_t bvb64_block_ctz(uint64_t x) { return (size_t)__builtin_ctzll(x); }
+BV_BLOCKS(bvb64, uint64_t, 64)
+
+// MARK: 128-bit blocks
+#ifdef __SIZEOF_INT128__
+typedef unsigned __int128 bv_u128;
+static inline bv_u128 bvb128_block_shl(bv_u128 x, size_t k) { return x << k; }
+static inline bv_u128 bvb128_block_shr(bv_u128 x, size_t k) { return x >> k; }
+static inline bv_u128 bvb128_block_bit(size_t k) { return (bv_u128)1 << k; }
+static inline bool bvb128_block_is_zero(bv_u128 x) { return x == 0; }
+static inline size_t bvb128_block_popcount(bv_u128 x)
+{
+    return (size_t)(__builtin_popcountll((uint64_t)x) + __builtin_popcountll((uint64_t)(x >> 64)));
+}
+static inline size_t bvb128_block_ctz(bv_u128 x)
+{
+    return (uint64_t)x ? (size_t)__builtin_ctzll((uint64_t)x)
+                       : 64 + (size_t)__builtin_ctzll((uint64_t)(x >> 64));
+}
+BV_BLOCKS(bvb128, bv_u128, 128)
+#endif
+
+// MARK: 256-bit blocks
+// A GCC/clang vector of four words, with the lowest bits in word 0. &, |
+// and ~ work on all four at once, and so do the shifts, with shuffles to
+// move the words.
+// With AVX2 enabled (-mavx2 or -march=native) a block is one register,
+// otherwise the compiler splits it in two.
+typedef uint64_t bv_v256 __attribute__((vector_size(32)));
+
+// The words moved up (towards word 3) or down by n, with zeros shifted in.
+// clang-format off
+#ifdef __clang__
+#define BV_V256_SHUFFLE(X, Z, A, B, C, D) __builtin_shufflevector(X, Z, A, B, C, D)
+#else
+#define BV_V256_SHUFFLE(X, Z, A, B, C, D) __builtin_shuffle(X, Z, (bv_v256){A, B, C, D})
+#endif
+// clang-format on
+static inline bv_v256 bvb256_words_up(bv_v256 x, size_t n)
+{
+    bv_v256 z = {0};
+    switch (n)
+    {
+    case 0:
+        return x;
+    case 1:
+        return BV_V256_SHUFFLE(x, z, 4, 0, 1, 2);
+    case 2:
+        return BV_V256_SHUFFLE(x, z, 4, 4, 0, 1);
+    case 3:
+        return BV_V256_SHUFFLE(x, z, 4, 4, 4, 0);
+    default:
+        return z;
+    }
+}
+static inline bv_v256 bvb256_words_down(bv_v256 x, size_t n)
+{
+    bv_v256 z = {0};
+    switch (n)
+    {
+    case 0:
+        return x;
+    case 1:
+        return BV_V256_SHUFFLE(x, z, 1, 2, 3, 4);
+    case 2:
+        return BV_V256_SHUFFLE(x, z, 2, 3, 4, 4);
+    case 3:
+        return BV_V256_SHUFFLE(x, z, 3, 4, 4, 4);
+    default:
+        return z;
+    }
+}
+
+// Whole words with a shuffle, then the rest within the words, taking the
+// bits that cross into the next word from a copy moved one word over.
+static inline bv_v256 bvb256_block_shl(bv_v256 x, size_t k)
+{
+    size_t r = k % 64;
+    x = bvb256_words_up(x, k / 64);
+    return r ? (x << r) | (bvb256_words_up(x, 1) >> (64 - r)) : x;
+}
+static inline bv_v256 bvb256_block_shr(bv_v256 x, size_t k)
+{
+    size_t r = k % 64;
+    x = bvb256_words_down(x, k / 64);
+    return r ? (x >> r) | (bvb256_words_down(x, 1) << (64 - r)) : x;
+}
+static inline bv_v256 bvb256_block_bit(size_t k)
+{
+    bv_v256 u = {0};
+    u[k / 64] = (uint64_t)1 << (k % 64);
+    return u;
+}
+static inline bool bvb256_block_is_zero(bv_v256 x)
+{
+    return (x[0] | x[1] | x[2] | x[3]) == 0;
+}
+static inline size_t bvb256_block_popcount(bv_v256 x)
+{
+    return (size_t)(__builtin_popcountll(x[0]) + __builtin_popcountll(x[1]) +
+                    __builtin_popcountll(x[2]) + __builtin_popcountll(x[3]));
+}
+static inline size_t bvb256_block_ctz(bv_v256 x)
+{
+    size_t i = 0;
+    while (x[i] == 0)
+        i++;
+    return 64 * i + (size_t)__builtin_ctzll(x[i]);
+}
+BV_BLOCKS(bvb256, bv_v256, 256)
+
+#endif // BV_BLOCK_H
@@ -0,0 +1,129 @@
+#include "bv_block.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every operation of each block type against the same one on struct bv,
+// for lengths around the block boundaries and shifts across them.
+// clang-format off
+#define TEST_BLOCKS(NAME, BITS)                                                  \
+    static void check_##NAME(struct NAME const *v, struct bv const *expected)    \
+    {                                                                            \
+        struct bv *u = NAME##_to_bv(v);                                          \
+        assert(bv_eq(u, expected));                                              \
+        for (size_t i = 0; i < v->len; i++)                                      \
+            assert(NAME##_get(v, i) == bv_get(expected, i));                     \
+        /* and nothing set beyond the end */                                     \
+        size_t count = 0;                                                        \
+        for (size_t i = 0; i < (BITS) * NAME##_no_blocks(v->len); i++)           \
+            count += NAME##_get(v, i);                                           \
+        assert(count == bv_count(expected));                                     \
+        free(u);                                                                 \
+    }                                                                            \
+                                                                                 \
+    static void test_##NAME(void)                                                \
+    {                                                                            \
+        size_t lens[] = {0, 1, (BITS) - 1, (BITS), (BITS) + 1, 3 * (BITS) + 7, 1000}; \
+        for (size_t l = 0; l < sizeof lens / sizeof *lens; l++)                  \
+        {                                                                        \
+            size_t len = lens[l];                                                \
+            struct bv *a = random_vector(len), *b = random_vector(len);          \
+            struct NAME *x = NAME##_from_bv(a), *y = NAME##_from_bv(b);          \
+            check_##NAME(x, a);                                                  \
+            assert(NAME##_eq(x, x) && NAME##_eq(x, y) == bv_eq(a, b));           \
+            assert(NAME##_count(x) == bv_count(a));                              \
+                                                                                 \
+            struct NAME *z = NAME##_or(x, y);                                    \
+            struct bv *c = bv_or(a, b);                                          \
+            check_##NAME(z, c);                                                  \
+            free(z);                                                             \
+            free(c);                                                             \
+            z = NAME##_and(x, y);                                                \
+            c = bv_and(a, b);                                                    \
+            check_##NAME(z, c);                                                  \
+            free(z);                                                             \
+            free(c);                                                             \
+                                                                                 \
+            for (int i = 0; i < 50; i++)                                         \
+            {                                                                    \
+                size_t k = rng() % (len + (BITS) + 2);                           \
+                switch (rng() % 6)                                               \
+                {                                                                \
+                case 0:                                                          \
+                    NAME##_shift_up(x, k);                                       \
+                    bv_shift_up(a, k);                                           \
+                    break;                                                       \
+                case 1:                                                          \
+                    NAME##_shift_down(x, k);                                     \
+                    bv_shift_down(a, k);                                         \
+                    break;                                                       \
+                case 2:                                                          \
+                    k = (rng() & 1) ? 1 : k;                                     \
+                    NAME##_shift_up_or_assign(x, k, y);                          \
+                    bv_shift_up_or_assign(a, k, b);                              \
+                    break;                                                       \
+                case 3:                                                          \
+                    NAME##_neg(x);                                               \
+                    bv_neg(a);                                                   \
+                    break;                                                       \
+                case 4:                                                          \
+                    NAME##_and_assign(x, y);                                     \
+                    bv_and_assign(a, b);                                         \
+                    break;                                                       \
+                case 5:                                                          \
+                    if (rng() & 1)                                               \
+                    {                                                            \
+                        NAME##_one(x);                                           \
+                        bv_one(a);                                               \
+                    }                                                            \
+                    else                                                         \
+                    {                                                            \
+                        NAME##_zero(x);                                          \
+                        bv_zero(a);                                              \
+                    }                                                            \
+                    break;                                                       \
+                }                                                                \
+                check_##NAME(x, a);                                              \
+                assert(NAME##_count(x) == bv_count(a));                          \
+                                                                                 \
+                /* The ones in order, from every start position. */              \
+                for (size_t j = 0; j <= len; j++)                                \
+                    assert(NAME##_find_next(x, j) == bv_find_next(a, j));        \
+                assert(NAME##_find_first(x) == bv_find_first(a));                \
+            }                                                                    \
+                                                                                 \
+            struct NAME *copy = NAME##_copy(x);                                  \
+            assert(NAME##_eq(copy, x));                                          \
+            if (len > 0)                                                         \
+            {                                                                    \
+                NAME##_set(copy, len - 1, !NAME##_get(copy, len - 1));           \
+                assert(!NAME##_eq(copy, x));                                     \
+            }                                                                    \
+            free(copy);                                                          \
+            free(a);                                                             \
+            free(b);                                                             \
+            free(x);                                                             \
+            free(y);                                                             \
+        }                                                                        \
+    }
+// clang-format on
+
+TEST_BLOCKS(bvb32, 32)
+TEST_BLOCKS(bvb64, 64)
+#ifdef __SIZEOF_INT128__
+TEST_BLOCKS(bvb128, 128)
+#endif
+TEST_BLOCKS(bvb256, 256)
+
+int main(void)
+{
+    test_bvb32();
+    test_bvb64();
+#ifdef __SIZEOF_INT128__
+    test_bvb128();
+#endif
+    test_bvb256();
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include "bv_expr.h"
+#include "bv_kernels.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Words per block. A stack of a handful of these, plus the inputs' blocks,
+// sits comfortably in the L1 cache, and it is long enough that the kernel
+// calls per block don't matter.
+#define BLOCK 128
+#define LOCAL_DEPTH 8
+
+struct instr
+{
+    enum bv_expr_op op;
+    size_t var;
+    bool push; // push vars[var] rather than apply op
+};
+
+struct bv_expr
+{
+    size_t n, cap;
+    size_t depth, max_depth; // stack depth at the end of the program, and the most we need
+    size_t no_vars;
+    struct instr *code;
+};
+
+// MARK: Building programs
+struct bv_expr *bv_expr_new(void)
+{
+    struct bv_expr *e = calloc(1, sizeof *e);
+    assert(e); // We don't handle allocation errors
+    return e;
+}
+
+void bv_expr_free(struct bv_expr *e)
+{
+    if (!e)
+        return;
+    free(e->code);
+    free(e);
+}
+
+size_t bv_expr_no_vars(struct bv_expr const *e)
+{
+    return e->no_vars;
+}
+
+static void emit(struct bv_expr *e, struct instr in)
+{
+    if (e->n == e->cap)
+    {
+        e->cap = e->cap ? 2 * e->cap : 16;
+        e->code = realloc(e->code, e->cap * sizeof *e->code);
+        assert(e->code); // We don't handle allocation errors
+    }
+    e->code[e->n++] = in;
+}
+
+static inline bool last_is_not(struct bv_expr const *e)
+{
+    return e->n > 0 && !e->code[e->n - 1].push && e->code[e->n - 1].op == BV_EXPR_NOT;
+}
+
+struct bv_expr *bv_expr_var(struct bv_expr *e, size_t i)
+{
+    emit(e, (struct instr){.push = true, .var = i});
+    if (i + 1 > e->no_vars)
+        e->no_vars = i + 1;
+    if (++e->depth > e->max_depth)
+        e->max_depth = e->depth;
+    return e;
+}
+
+struct bv_expr *bv_expr_op(struct bv_expr *e, enum bv_expr_op op)
+{
+    if (op == BV_EXPR_NOT)
+    {
+        assert(e->depth >= 1);
+        if (last_is_not(e)) // ~~x is x
+            e->n--;
+        else
+            emit(e, (struct instr){.op = op});
+        return e;
+    }
+
+    assert(e->depth >= 2);
+    e->depth--;
+    if (op == BV_EXPR_AND && last_is_not(e))
+    {
+        // x & ~y in one step rather than two, and without the buffer for ~y.
+        e->code[e->n - 1].op = BV_EXPR_ANDNOT;
+    }
+    else
+    {
+        emit(e, (struct instr){.op = op});
+    }
+    return e;
+}
+
+// MARK: Parsing
+// Recursive descent over the grammar
+//
+//     or   := xor ('|' xor)*
+//     xor  := and ('^' and)*
+//     and  := not ('&' not)*
+//     not  := '~' not | '(' or ')' | 'a' ... 'z'
+//
+// emitting postfix code as we go. Each returns false on a syntax error.
+struct parser
+{
+    const char *s;
+    struct bv_expr *e;
+};
+
+static char peek(struct parser *p)
+{
+    while (*p->s == ' ' || *p->s == '\t' || *p->s == '\n')
+        p->s++;
+    return *p->s;
+}
+
+static bool parse_or(struct parser *p);
+
+static bool parse_not(struct parser *p)
+{
+    char c = peek(p);
+    if (c == '~')
+    {
+        p->s++;
+        if (!parse_not(p))
+            return false;
+        bv_expr_op(p->e, BV_EXPR_NOT);
+        return true;
+    }
+    if (c == '(')
+    {
+        p->s++;
+        if (!parse_or(p) || peek(p) != ')')
+            return false;
+        p->s++;
+        return true;
+    }
+    if ('a' <= c && c <= 'z')
+    {
+        p->s++;
+        bv_expr_var(p->e, (size_t)(c - 'a'));
+        return true;
+    }
+    return false;
+}
+
+// clang-format off
+#define BINARY(NAME, NEXT, CHAR, OP)                                             \
+    static bool NAME(struct parser *p)                                           \
+    {                                                                            \
+        if (!NEXT(p))                                                            \
+            return false;                                                        \
+        while (peek(p) == (CHAR))                                                \
+        {                                                                        \
+            p->s++;                                                              \
+            if (!NEXT(p))                                                        \
+                return false;                                                    \
+            bv_expr_op(p->e, (OP));                                              \
+        }                                                                        \
+        return true;                                                             \
+    }
+// clang-format on
+
+BINARY(parse_and, parse_not, '&', BV_EXPR_AND)
+BINARY(parse_xor, parse_and, '^', BV_EXPR_XOR)
+BINARY(parse_or, parse_xor, '|', BV_EXPR_OR)
+
+struct bv_expr *bv_expr_compile(const char *src)
+{
+    struct parser p = {.s = src, .e = bv_expr_new()};
+    if (!parse_or(&p) || peek(&p) != '\0')
+    {
+        bv_expr_free(p.e);
+        return NULL;
+    }
+    return p.e;
+}
+
+// MARK: Evaluation
+// The stack holds pointers to the current block of each value: the input's
+// own words for a variable, and a buffer for a computed value. The value
+// at stack position i goes in buffer i, except that the last instruction
+// writes straight to dst.
+struct bv *bv_expr_eval(struct bv_expr const *e, struct bv *dst,
+                        struct bv const *const vars[])
+{
+    assert(e->n > 0 && e->depth == 1);
+    for (size_t i = 0; i < e->no_vars; i++)
+    {
+        assert(vars[i]->len == dst->len);
+    }
+
+    // Most expressions are shallow enough for buffers on the C stack, which
+    // saves two mallocs per call on small vectors.
+    uint64_t const *local_stack[LOCAL_DEPTH];
+    uint64_t local_buf[LOCAL_DEPTH * BLOCK];
+    uint64_t const **stack = local_stack;
+    uint64_t *buf = local_buf;
+    if (e->max_depth > LOCAL_DEPTH)
+    {
+        stack = malloc(e->max_depth * sizeof *stack);
+        buf = malloc(e->max_depth * BLOCK * sizeof *buf);
+        assert(stack && buf); // We don't handle allocation errors
+    }
+
+    size_t no_words = (dst->len + 63) / 64;
+    for (size_t w = 0; w < no_words; w += BLOCK)
+    {
+        size_t n = (no_words - w < BLOCK) ? no_words - w : BLOCK;
+        size_t sp = 0;
+        for (size_t pc = 0; pc < e->n; pc++)
+        {
+            struct instr in = e->code[pc];
+            if (in.push)
+            {
+                stack[sp++] = vars[in.var]->data + w;
+                continue;
+            }
+
+            size_t top = (in.op == BV_EXPR_NOT) ? sp - 1 : sp - 2;
+            uint64_t *out = (pc + 1 == e->n) ? dst->data + w : buf + top * BLOCK;
+            uint64_t const *x = stack[top], *y = stack[sp - 1];
+            switch (in.op)
+            {
+            case BV_EXPR_NOT:
+                bv_kernels.not_words(out, x, n);
+                break;
+            case BV_EXPR_AND:
+                bv_kernels.and_words(out, x, y, n);
+                break;
+            case BV_EXPR_OR:
+                bv_kernels.or_words(out, x, y, n);
+                break;
+            case BV_EXPR_XOR:
+                bv_kernels.xor_words(out, x, y, n);
+                break;
+            case BV_EXPR_ANDNOT:
+                bv_kernels.andnot_words(out, x, y, n);
+                break;
+            }
+            stack[top] = out;
+            sp = top + 1;
+        }
+
+        // A lone variable is never written to dst above.
+        if (stack[0] != dst->data + w)
+            bv_kernels.copy_words(dst->data + w, stack[0], n);
+    }
+
+    if (stack != local_stack)
+    {
+        free(stack);
+        free(buf);
+    }
+
+    // A negation sets the bits past the end.
+    if (dst->len % 64)
+        dst->data[no_words - 1] &= ((uint64_t)1 << (dst->len % 64)) - 1;
+    return dst;
+}
@@ -0,0 +1,56 @@
+#ifndef BV_EXPR_H
+#define BV_EXPR_H
+
+#include "bv.h"
+
+// Bitwise expressions over several vectors, evaluated in a single pass.
+//
+// Combining N vectors with the operations in bv.h takes N - 1 passes over
+// vectors the size of the result, and intermediate vectors for anything
+// that isn't a chain of |= or &=. Once the vectors are larger than the
+// cache, each of those passes goes to memory. An expression is compiled to
+// a small postfix program instead, and run over the inputs one block of
+// words at a time, with the intermediate results in a stack of block-sized
+// buffers that stay in the L1 cache. Each input is then read once and the
+// result written once.
+//
+// Expressions are built either from a string, with the variables a to z
+// standing for vars[0] to vars[25],
+//
+//     struct bv_expr *e = bv_expr_compile("(a & b) | (~c & d)");
+//
+// where ~ binds tighter than &, which binds tighter than ^, which binds
+// tighter than | (as in C), or pushed one term at a time in postfix order,
+//
+//     struct bv_expr *e = bv_expr_new();
+//     bv_expr_var(bv_expr_var(e, 0), 1);
+//     bv_expr_op(e, BV_EXPR_AND);
+//
+// which takes any number of variables.
+enum bv_expr_op
+{
+    BV_EXPR_NOT,    // ~x, on the top of the stack
+    BV_EXPR_AND,    // x & y, on the two top values, y on top
+    BV_EXPR_OR,     // x | y
+    BV_EXPR_XOR,    // x ^ y
+    BV_EXPR_ANDNOT, // x & ~y
+};
+
+struct bv_expr;
+
+struct bv_expr *bv_expr_new(void);                          // the empty program
+struct bv_expr *bv_expr_var(struct bv_expr *e, size_t i);   // push vars[i]
+struct bv_expr *bv_expr_op(struct bv_expr *e, enum bv_expr_op op);
+struct bv_expr *bv_expr_compile(const char *src); // NULL on a syntax error
+void bv_expr_free(struct bv_expr *e);
+
+// The number of variables the expression uses, i.e., one more than the
+// largest index, so vars must hold at least this many vectors.
+size_t bv_expr_no_vars(struct bv_expr const *e);
+
+// dst = the expression over vars, which must all have dst's length. dst can
+// be one of the vars. The program must leave exactly one value on the stack.
+struct bv *bv_expr_eval(struct bv_expr const *e, struct bv *dst,
+                        struct bv const *const vars[]);
+
+#endif // BV_EXPR_H
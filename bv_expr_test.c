@@ -0,0 +1,195 @@
+#include "bv_expr.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_VARS 10
+
+// Write a random expression over the first NO_VARS variables to buf and
+// return the vector it should evaluate to, computed bit by bit.
+static struct bv *random_expr(char **buf, struct bv *const vars[], size_t n, int depth)
+{
+    int kind = (depth == 0) ? 0 : (int)(rng() % 6);
+    if (kind == 0)
+    {
+        size_t i = rng() % NO_VARS;
+        *(*buf)++ = (char)('a' + i);
+        return bv_copy(vars[i]);
+    }
+    if (kind == 1)
+    {
+        *(*buf)++ = '~';
+        struct bv *x = random_expr(buf, vars, n, depth - 1);
+        for (size_t i = 0; i < n; i++)
+        {
+            bv_set(x, i, !bv_get(x, i));
+        }
+        return x;
+    }
+
+    // The binary operators, with x & ~y written out to exercise the andnot.
+    char const *ops[] = {"&", "|", "^", "&~"};
+    int op = kind - 2;
+    *(*buf)++ = '(';
+    struct bv *x = random_expr(buf, vars, n, depth - 1);
+    size_t len = strlen(ops[op]);
+    memcpy(*buf, ops[op], len);
+    *buf += len;
+    struct bv *y = random_expr(buf, vars, n, depth - 1);
+    *(*buf)++ = ')';
+    for (size_t i = 0; i < n; i++)
+    {
+        bool a = bv_get(x, i), b = bv_get(y, i);
+        bool r = (op == 0) ? (a & b) : (op == 1) ? (a | b) : (op == 2) ? (a ^ b) : (a & !b);
+        bv_set(x, i, r);
+    }
+    free(y);
+    return x;
+}
+
+static void test_random(void)
+{
+    // Lengths around the block size (128 words) and around the SIMD tails.
+    size_t sizes[] = {0, 1, 63, 64, 65, 200, 1000, 8191, 8192, 8193, 20000};
+    for (int isa = BV_ISA_SCALAR; isa <= BV_ISA_AVX512; isa++)
+    {
+        if (bv_isa_select((enum bv_isa)isa) != (enum bv_isa)isa)
+            continue; // not supported here
+
+        for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+        {
+            size_t n = sizes[s];
+            struct bv *vars[NO_VARS];
+            for (size_t i = 0; i < NO_VARS; i++)
+            {
+                vars[i] = random_vector(n);
+            }
+
+            for (int rep = 0; rep < 20; rep++)
+            {
+                char src[4096], *p = src;
+                struct bv *expected = random_expr(&p, vars, n, 1 + rep % 6);
+                *p = '\0';
+
+                struct bv_expr *e = bv_expr_compile(src);
+                assert(e);
+                struct bv *dst = bv_new(n);
+                bv_expr_eval(e, dst, (struct bv const *const *)vars);
+                assert(bv_eq(dst, expected));
+
+                free(dst);
+                free(expected);
+                bv_expr_free(e);
+            }
+
+            for (size_t i = 0; i < NO_VARS; i++)
+            {
+                free(vars[i]);
+            }
+        }
+    }
+    bv_isa_select(BV_ISA_AVX512);
+}
+
+static void test_precedence(void)
+{
+    struct bv *a = bv_new_from_string("0011");
+    struct bv *b = bv_new_from_string("0101");
+    struct bv *c = bv_new_from_string("1001");
+    struct bv const *vars[] = {a, b, c};
+    struct
+    {
+        const char *src, *expected;
+    } tests[] = {
+        {"a", "0011"},
+        {"~a", "1100"},
+        {"~~a", "0011"},
+        {"a | b & c", "0011"},  // a | (b & c)
+        {"a & b | c", "1001"},  // (a & b) | c
+        {"a ^ b & c", "0010"},  // a ^ (b & c)
+        {"a | b ^ c", "1111"},  // a | (b ^ c)
+        {"~a & b", "0100"},
+        {"a & ~b", "0010"},
+        {"~(a | b)", "1000"},
+        {" ( a\t&\nb ) ", "0001"},
+    };
+    for (size_t t = 0; t < sizeof tests / sizeof *tests; t++)
+    {
+        struct bv_expr *e = bv_expr_compile(tests[t].src);
+        assert(e && bv_expr_no_vars(e) <= 3);
+        struct bv *dst = bv_expr_eval(e, bv_new(4), vars);
+        struct bv *expected = bv_new_from_string(tests[t].expected);
+        assert(bv_eq(dst, expected));
+        free(dst);
+        free(expected);
+        bv_expr_free(e);
+    }
+
+    // The destination can be one of the inputs
+    struct bv_expr *e = bv_expr_compile("~a ^ b");
+    bv_expr_eval(e, a, vars);
+    struct bv *expected = bv_new_from_string("1001");
+    assert(bv_eq(a, expected));
+    free(expected);
+    bv_expr_free(e);
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+static void test_syntax_errors(void)
+{
+    const char *bad[] = {"", "a &", "& a", "(a | b", "a | b)", "a b", "A", "a + b", "~", "()"};
+    for (size_t i = 0; i < sizeof bad / sizeof *bad; i++)
+    {
+        assert(bv_expr_compile(bad[i]) == NULL);
+    }
+}
+
+// Building the program by hand, with more variables than letters.
+static void test_builder(void)
+{
+    size_t n = 1000, no_vars = 40;
+    struct bv **vars = malloc(no_vars * sizeof *vars);
+    struct bv *expected = bv_new(n);
+    struct bv_expr *e = bv_expr_new();
+    for (size_t i = 0; i < no_vars; i++)
+    {
+        vars[i] = random_vector(n);
+        bv_or_assign(expected, vars[i]);
+        bv_expr_var(e, i);
+        if (i > 0)
+            bv_expr_op(e, BV_EXPR_OR);
+    }
+    // Then ~(... | v39) & v0, in postfix.
+    bv_expr_op(e, BV_EXPR_NOT);
+    bv_expr_var(e, 0);
+    bv_expr_op(e, BV_EXPR_AND);
+    assert(bv_expr_no_vars(e) == no_vars);
+
+    bv_and_assign(bv_neg(expected), vars[0]);
+    struct bv *dst = bv_expr_eval(e, bv_new(n), (struct bv const *const *)vars);
+    assert(bv_eq(dst, expected)); // which is all zeros
+
+    free(dst);
+    free(expected);
+    bv_expr_free(e);
+    for (size_t i = 0; i < no_vars; i++)
+    {
+        free(vars[i]);
+    }
+    free(vars);
+}
+
+int main(void)
+{
+    test_random();
+    test_precedence();
+    test_syntax_errors();
+    test_builder();
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "bv_file.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC "BVWORDS"
+#define VERSION 1
+#define ENDIAN_MARK 0x0102030405060708
+#define HEADER_SIZE 128
+#define LEN_OFFSET (HEADER_SIZE - offsetof(struct bv, data))
+
+struct header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t word_bits;
+    uint64_t endian;
+    uint64_t no_words;
+    uint64_t checksum;
+    char reserved[LEN_OFFSET - 40];
+    size_t len; // the start of the struct bv in the mapping
+};
+
+_Static_assert(sizeof(struct header) == HEADER_SIZE, "header must be 128 bytes");
+_Static_assert(offsetof(struct header, len) + offsetof(struct bv, data) == HEADER_SIZE,
+               "the words must follow the length like in struct bv");
+
+// MARK: Helpers
+static inline size_t no_words(size_t no_bits)
+{
+    return (no_bits + 63) / 64;
+}
+
+// The last word with the bits beyond the end masked out, so what we write
+// doesn't depend on whether the vector was clean.
+static inline uint64_t last_word(struct bv const *v)
+{
+    uint64_t w = v->data[no_words(v->len) - 1];
+    size_t k = v->len % 64;
+    return k ? w & (((uint64_t)1 << k) - 1) : w;
+}
+
+static uint64_t checksum(struct bv const *v)
+{
+    uint64_t h = 0xcbf29ce484222325; // FNV-1a, a word at a time
+    size_t n = no_words(v->len);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        h = (h ^ v->data[i]) * 0x100000001b3;
+    }
+    if (n > 0)
+    {
+        h = (h ^ last_word(v)) * 0x100000001b3;
+    }
+    return h;
+}
+
+static bool write_all(FILE *f, const void *buf, size_t size)
+{
+    return fwrite(buf, 1, size, f) == size;
+}
+
+// MARK: Saving
+int bv_save(struct bv const *v, const char *path)
+{
+    FILE *f = fopen(path, "wb"); // FlawFinder: ignore
+    if (!f)
+        return -1;
+
+    struct header h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, MAGIC, sizeof h.magic);
+    h.version = VERSION;
+    h.word_bits = 64;
+    h.endian = ENDIAN_MARK;
+    h.no_words = no_words(v->len);
+    h.checksum = checksum(v);
+    h.len = v->len;
+
+    bool ok = write_all(f, &h, sizeof h);
+    if (ok && h.no_words > 0)
+    {
+        uint64_t last = last_word(v);
+        ok = write_all(f, v->data, (h.no_words - 1) * sizeof *v->data) &&
+             write_all(f, &last, sizeof last);
+    }
+
+    if (fclose(f) != 0)
+        ok = false;
+    if (!ok)
+    {
+        int err = errno;
+        remove(path); // don't leave a truncated vector behind
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+// MARK: Mapping
+// file_size is at least HEADER_SIZE. A corrupt length or word count must
+// not overflow the arithmetic: a length near SIZE_MAX would round to zero
+// words, and a huge word count times eight could wrap to the file size.
+static bool valid_header(struct header const *h, size_t file_size)
+{
+    return memcmp(h->magic, MAGIC, sizeof h->magic) == 0 &&
+           h->version == VERSION &&
+           h->word_bits == 64 &&
+           h->endian == ENDIAN_MARK &&
+           h->len <= SIZE_MAX - 63 &&
+           h->no_words == no_words(h->len) &&
+           h->no_words <= (file_size - HEADER_SIZE) / sizeof(uint64_t) &&
+           file_size == HEADER_SIZE + h->no_words * sizeof(uint64_t);
+}
+
+struct bv const *bv_open_mmap(const char *path, bool verify)
+{
+    int fd = open(path, O_RDONLY); // FlawFinder: ignore
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < HEADER_SIZE)
+    {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd); // the mapping keeps the file alive
+    if (map == MAP_FAILED)
+    {
+        errno = err;
+        return NULL;
+    }
+
+    struct header const *h = map;
+    struct bv const *v = (struct bv const *)((char const *)map + LEN_OFFSET);
+    if (!valid_header(h, size) || (verify && checksum(v) != h->checksum))
+    {
+        munmap(map, size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return v;
+}
+
+void bv_close_mmap(struct bv const *v)
+{
+    struct header const *h = (struct header const *)((char const *)v - LEN_OFFSET);
+    munmap((void *)h, HEADER_SIZE + h->no_words * sizeof(uint64_t));
+}
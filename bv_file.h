@@ -0,0 +1,36 @@
+#ifndef BV_FILE_H
+#define BV_FILE_H
+
+// Saving bit vectors to disk, and mapping them back in without copying.
+//
+// The file starts with a 128-byte header, followed by the words of the
+// vector, so the words start 64-byte aligned (a cache line) in the file and
+// thus in the mapping. The header holds
+//
+//   offset   0: magic "BVWORDS\0"
+//   offset   8: format version (uint32_t, currently 1)
+//   offset  12: bits per word (uint32_t, 64)
+//   offset  16: 0x0102030405060708 in the writer's byte order
+//   offset  24: number of words (uint64_t)
+//   offset  32: checksum of the words (uint64_t, 64-bit FNV-1a over words)
+//   offset 120: length of the vector in bits (size_t, i.e. struct bv's len)
+//
+// The length sits right before the words, so the mapped file from offset
+// 120 *is* a struct bv, and bv_open_mmap() just returns a pointer into the
+// mapping. The integers are in the writer's byte order; we refuse to open
+// files written on a machine with a different one.
+
+#include "bv.h"
+
+// Write v to path. Returns 0 on success and -1 (with errno set) on failure.
+int bv_save(struct bv const *v, const char *path);
+
+// Map the vector in the file at path, read-only. If verify is true, we
+// also check the checksum, which means reading the whole file; otherwise
+// opening doesn't touch the words at all, and pages are read in when used.
+// Returns NULL (with errno set; EINVAL for files that aren't valid vector
+// files) on failure. The result must be released with bv_close_mmap().
+struct bv const *bv_open_mmap(const char *path, bool verify);
+void bv_close_mmap(struct bv const *v);
+
+#endif // BV_FILE_H
@@ -0,0 +1,123 @@
+#include "bv_file.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static char path[] = "/tmp/bv_file_test_XXXXXX";
+
+static void test_round_trip(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 1000, 100000};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        struct bv *v = bv_new(sizes[s]);
+        for (size_t i = 0; i < v->len; i++)
+        {
+            bv_set(v, i, rng() & 1);
+        }
+        int saved = bv_save(v, path);
+        assert(saved == 0);
+
+        struct bv const *w = bv_open_mmap(path, true);
+        assert(w);
+        assert(((uintptr_t)w->data % 64) == 0); // cache-line aligned words
+        assert(bv_eq(v, w));
+
+        // The mapped vector works with the other operations.
+        struct bv *u = bv_or(v, w);
+        assert(bv_eq(u, v));
+        free(u);
+
+        bv_close_mmap(w);
+        free(v);
+    }
+}
+
+static void test_dirty_tail(void)
+{
+    // Bits beyond the end are not saved.
+    struct bv *v = bv_one(bv_new(10));
+    v->data[0] = ~(uint64_t)0;
+    int saved = bv_save(v, path);
+    assert(saved == 0);
+    struct bv const *w = bv_open_mmap(path, true);
+    assert(w && w->data[0] == 0x3ff);
+    bv_close_mmap(w);
+    free(v);
+}
+
+static void test_invalid(void)
+{
+    struct bv *v = bv_one(bv_new(1000));
+    int saved = bv_save(v, path);
+    assert(saved == 0);
+
+    // Flip a bit in the words: only caught if we check the checksum.
+    FILE *f = fopen(path, "r+b");
+    assert(f);
+    fseek(f, 200, SEEK_SET);
+    fputc(0x7f, f);
+    fclose(f);
+    struct bv const *w = bv_open_mmap(path, false);
+    assert(w);
+    bv_close_mmap(w);
+    errno = 0;
+    assert(bv_open_mmap(path, true) == NULL && errno == EINVAL);
+
+    // Truncated file.
+    saved = bv_save(v, path);
+    assert(saved == 0);
+    int truncated = truncate(path, 128 + 8);
+    assert(truncated == 0);
+    errno = 0;
+    assert(bv_open_mmap(path, false) == NULL && errno == EINVAL);
+
+    // A length so large its word count wraps around to zero, in a file
+    // with just the header. The length is the last word of the header.
+    struct bv *empty = bv_new(0);
+    saved = bv_save(empty, path);
+    assert(saved == 0);
+    free(empty);
+    f = fopen(path, "r+b");
+    assert(f);
+    size_t huge = SIZE_MAX - 10;
+    fseek(f, 128 - (long)sizeof huge, SEEK_SET);
+    fwrite(&huge, sizeof huge, 1, f);
+    fclose(f);
+    errno = 0;
+    assert(bv_open_mmap(path, false) == NULL && errno == EINVAL);
+
+    // Not a vector at all.
+    f = fopen(path, "wb");
+    assert(f);
+    fputs("hello, world", f);
+    fclose(f);
+    errno = 0;
+    assert(bv_open_mmap(path, false) == NULL && errno == EINVAL);
+
+    // Not there at all.
+    remove(path);
+    errno = 0;
+    assert(bv_open_mmap(path, false) == NULL && errno == ENOENT);
+
+    free(v);
+}
+
+int main(void)
+{
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    test_round_trip();
+    test_dirty_tail();
+    test_invalid();
+
+    remove(path);
+    return 0;
+}
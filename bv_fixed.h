@@ -0,0 +1,131 @@
+#ifndef BV_FIXED_H
+#define BV_FIXED_H
+
+// Bit vectors with a width fixed at compile time: bvf64, bvf128, bvf256
+// and bvf512, of one, two, four and eight words.
+//
+// struct bv has its length at runtime and lives on the heap, so every
+// operation loops over a number of words it doesn't know in advance. These
+// are small structs passed and returned by value, and the loops over their
+// words have a constant trip count, so the compiler unrolls them and keeps
+// the whole vector in registers (general purpose or SIMD, as it sees fit).
+// That is how sao_raw gets its speed, just not limited to 64 bits.
+//
+// All bits of a fixed-width vector are used, so there is nothing to clean:
+// _one() sets all of them and shifts move bits out at the top.
+
+#include "bv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// clang-format off
+#define BV_FIXED(NAME, WORDS)                                                    \
+    struct NAME                                                                  \
+    {                                                                            \
+        uint64_t w[WORDS];                                                       \
+    };                                                                           \
+                                                                                 \
+    static inline struct NAME NAME##_zero(void)                                  \
+    {                                                                            \
+        struct NAME v;                                                           \
+        for (size_t i = 0; i < (WORDS); i++) v.w[i] = 0;                         \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME NAME##_one(void)                                   \
+    {                                                                            \
+        struct NAME v;                                                           \
+        for (size_t i = 0; i < (WORDS); i++) v.w[i] = ~(uint64_t)0;              \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    /* The first WORDS * 64 bits of v, padded with zeros if it is shorter. */    \
+    static inline struct NAME NAME##_from_bv(struct bv const *v)                 \
+    {                                                                            \
+        struct NAME u = NAME##_zero();                                           \
+        size_t n = (v->len + 63) / 64;                                           \
+        for (size_t i = 0; i < (WORDS) && i < n; i++) u.w[i] = v->data[i];       \
+        return u;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline bool NAME##_get(struct NAME v, size_t i)                       \
+    {                                                                            \
+        return !!((uint64_t)1 & (v.w[bv_widx(i)] >> bv_bidx(i)));                \
+    }                                                                            \
+    static inline struct NAME NAME##_set(struct NAME v, size_t i, bool b)        \
+    {                                                                            \
+        uint64_t mask = (uint64_t)1 << bv_bidx(i);                               \
+        v.w[bv_widx(i)] = b ? (v.w[bv_widx(i)] | mask)                           \
+                            : (v.w[bv_widx(i)] & ~mask);                         \
+        return v;                                                                \
+    }                                                                            \
+                                                                                 \
+    static inline struct NAME NAME##_neg(struct NAME v)                          \
+    {                                                                            \
+        for (size_t i = 0; i < (WORDS); i++) v.w[i] = ~v.w[i];                   \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME NAME##_or(struct NAME v, struct NAME w)            \
+    {                                                                            \
+        for (size_t i = 0; i < (WORDS); i++) v.w[i] |= w.w[i];                   \
+        return v;                                                                \
+    }                                                                            \
+    static inline struct NAME NAME##_and(struct NAME v, struct NAME w)           \
+    {                                                                            \
+        for (size_t i = 0; i < (WORDS); i++) v.w[i] &= w.w[i];                   \
+        return v;                                                                \
+    }                                                                            \
+    static inline bool NAME##_eq(struct NAME v, struct NAME w)                   \
+    {                                                                            \
+        uint64_t diff = 0;                                                       \
+        for (size_t i = 0; i < (WORDS); i++) diff |= v.w[i] ^ w.w[i];            \
+        return diff == 0;                                                        \
+    }                                                                            \
+                                                                                 \
+    /* v << k, for any k (all zeros if k >= WORDS * 64). */                      \
+    static inline struct NAME NAME##_shift_up(struct NAME v, size_t k)           \
+    {                                                                            \
+        size_t offset = k / 64, r = k % 64;                                      \
+        struct NAME u;                                                           \
+        for (size_t i = (WORDS); i-- > 0;)                                       \
+        {                                                                        \
+            uint64_t hi = (i >= offset) ? v.w[i - offset] : 0;                   \
+            uint64_t lo = (i >= offset + 1) ? v.w[i - offset - 1] : 0;           \
+            u.w[i] = (hi << r) | (r ? lo >> (64 - r) : 0);                       \
+        }                                                                        \
+        return u;                                                                \
+    }                                                                            \
+    /* v >> k, for any k (all zeros if k >= WORDS * 64). */                      \
+    static inline struct NAME NAME##_shift_down(struct NAME v, size_t k)         \
+    {                                                                            \
+        size_t offset = k / 64, r = k % 64;                                      \
+        struct NAME u;                                                           \
+        for (size_t i = 0; i < (WORDS); i++)                                     \
+        {                                                                        \
+            uint64_t lo = (i + offset < (WORDS)) ? v.w[i + offset] : 0;          \
+            uint64_t hi = (i + offset + 1 < (WORDS)) ? v.w[i + offset + 1] : 0;  \
+            u.w[i] = (lo >> r) | (r ? hi << (64 - r) : 0);                       \
+        }                                                                        \
+        return u;                                                                \
+    }                                                                            \
+                                                                                 \
+    /* (v << 1) | w, the SHIFT-and-OR step. */                                   \
+    static inline struct NAME NAME##_shift_up_or(struct NAME v, struct NAME w)   \
+    {                                                                            \
+        struct NAME u;                                                           \
+        uint64_t carry = 0;                                                      \
+        for (size_t i = 0; i < (WORDS); i++)                                     \
+        {                                                                        \
+            u.w[i] = (v.w[i] << 1) | carry | w.w[i];                             \
+            carry = v.w[i] >> 63;                                                \
+        }                                                                        \
+        return u;                                                                \
+    }
+// clang-format on
+
+BV_FIXED(bvf64, 1)
+BV_FIXED(bvf128, 2)
+BV_FIXED(bvf256, 4)
+BV_FIXED(bvf512, 8)
+
+#endif // BV_FIXED_H
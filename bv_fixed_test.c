@@ -0,0 +1,91 @@
+#include "bv_fixed.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Check each operation against the same operation on struct bv of the same
+// length. The comparison is only used in asserts, so it is unused under
+// NDEBUG.
+// clang-format off
+#define TEST_FIXED(TYPE, BITS)                                                   \
+    __attribute__((unused))                                                      \
+    static bool TYPE##_same(struct TYPE f, struct bv const *v)                   \
+    {                                                                            \
+        for (size_t i = 0; i < (BITS); i++)                                      \
+            if (TYPE##_get(f, i) != bv_get(v, i))                                \
+                return false;                                                    \
+        return true;                                                             \
+    }                                                                            \
+                                                                                 \
+    static void test_##TYPE(void)                                                \
+    {                                                                            \
+        struct bv *zero = bv_new(BITS);                                          \
+        struct bv *one = bv_one(bv_new(BITS));                                   \
+        assert(TYPE##_same(TYPE##_zero(), zero));                                \
+        assert(TYPE##_same(TYPE##_one(), one));                                  \
+        free(zero);                                                              \
+        free(one);                                                               \
+                                                                                 \
+        for (int rep = 0; rep < 20; rep++)                                       \
+        {                                                                        \
+            struct bv *v = random_vector(BITS);                                  \
+            struct bv *w = random_vector(BITS);                                  \
+            struct TYPE fv = TYPE##_from_bv(v), fw = TYPE##_from_bv(w);          \
+            assert(TYPE##_same(fv, v) && TYPE##_same(fw, w));                    \
+            assert(TYPE##_eq(fv, fv) && !TYPE##_eq(fv, fw));                     \
+                                                                                 \
+            struct bv *u = bv_or(v, w);                                          \
+            assert(TYPE##_same(TYPE##_or(fv, fw), u));                           \
+            free(u);                                                             \
+            u = bv_and(v, w);                                                    \
+            assert(TYPE##_same(TYPE##_and(fv, fw), u));                          \
+            free(u);                                                             \
+            u = bv_neg(bv_copy(v));                                              \
+            assert(TYPE##_same(TYPE##_neg(fv), u));                              \
+            free(u);                                                             \
+                                                                                 \
+            for (size_t k = 0; k <= (BITS) + 1; k += 1 + rng() % 16)             \
+            {                                                                    \
+                u = bv_shift_up(bv_copy(v), k);                                  \
+                assert(TYPE##_same(TYPE##_shift_up(fv, k), u));                  \
+                free(u);                                                         \
+                u = bv_shift_down(bv_copy(v), k);                                \
+                assert(TYPE##_same(TYPE##_shift_down(fv, k), u));                \
+                free(u);                                                         \
+            }                                                                    \
+            u = bv_shift_up_or_assign(bv_copy(v), 1, w);                         \
+            assert(TYPE##_same(TYPE##_shift_up_or(fv, fw), u));                  \
+            free(u);                                                             \
+                                                                                 \
+            size_t i = rng() % (BITS);                                           \
+            bool b = !bv_get(v, i);                                              \
+            bv_set(v, i, b);                                                     \
+            assert(TYPE##_same(TYPE##_set(fv, i, b), v));                        \
+                                                                                 \
+            free(v);                                                             \
+            free(w);                                                             \
+        }                                                                        \
+                                                                                 \
+        /* Shorter vectors are padded with zeros */                              \
+        struct bv *v = bv_one(bv_new((BITS) - 3));                               \
+        struct TYPE f = TYPE##_from_bv(v);                                       \
+        assert(TYPE##_eq(f, TYPE##_shift_down(TYPE##_one(), 3)));                \
+        free(v);                                                                 \
+    }
+// clang-format on
+
+TEST_FIXED(bvf64, 64)
+TEST_FIXED(bvf128, 128)
+TEST_FIXED(bvf256, 256)
+TEST_FIXED(bvf512, 512)
+
+int main(void)
+{
+    test_bvf64();
+    test_bvf128();
+    test_bvf256();
+    test_bvf512();
+    return 0;
+}
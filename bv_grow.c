@@ -0,0 +1,126 @@
+#include "bv_grow.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+static inline size_t no_words(size_t no_bits)
+{
+    return (no_bits + 63) / 64;
+}
+
+static inline size_t alloc_size(size_t words)
+{
+    return offsetof(struct bv, data) + words * sizeof(uint64_t);
+}
+
+// MARK: Construction
+struct bv_grow *bv_grow_new(size_t cap)
+{
+    struct bv_grow *g = malloc(sizeof *g);
+    assert(g); // We don't handle allocation errors
+    g->cap = 64 * no_words(cap);
+    g->v = calloc(1, alloc_size(no_words(cap)));
+    assert(g->v); // We don't handle allocation errors
+    return g;
+}
+
+struct bv_grow *bv_grow_from_bv(struct bv const *v)
+{
+    struct bv_grow *g = bv_grow_new(v->len);
+    memcpy(g->v->data, v->data, no_words(v->len) * sizeof(uint64_t));
+    g->v->len = v->len;
+    return g;
+}
+
+void bv_grow_free(struct bv_grow *g)
+{
+    free(g->v);
+    free(g);
+}
+
+// MARK: Capacity
+struct bv_grow *bv_grow_reserve(struct bv_grow *g, size_t cap)
+{
+    if (cap <= g->cap)
+        return g;
+
+    // At least double, so a run of appends costs O(1) per bit.
+    size_t old_words = g->cap / 64;
+    size_t words = no_words(cap);
+    if (words < 2 * old_words)
+        words = 2 * old_words;
+
+    g->v = realloc(g->v, alloc_size(words));
+    assert(g->v); // We don't handle allocation errors
+    // The bits beyond the length must be zero.
+    memset(g->v->data + old_words, 0, (words - old_words) * sizeof(uint64_t));
+    g->cap = 64 * words;
+    return g;
+}
+
+struct bv_grow *bv_grow_shrink(struct bv_grow *g)
+{
+    size_t words = no_words(g->v->len);
+    g->v = realloc(g->v, alloc_size(words));
+    assert(g->v); // We don't handle allocation errors
+    g->cap = 64 * words;
+    return g;
+}
+
+struct bv *bv_grow_finish(struct bv_grow *g)
+{
+    struct bv *v = bv_grow_shrink(g)->v;
+    free(g);
+    return v;
+}
+
+// MARK: Appending
+struct bv_grow *bv_grow_push_bits(struct bv_grow *g, uint64_t x, size_t n)
+{
+    assert(n <= 64);
+    if (n == 0)
+        return g;
+    if (n < 64)
+        x &= ((uint64_t)1 << n) - 1; // keep the bits beyond the end zero
+
+    bv_grow_reserve(g, g->v->len + n);
+    size_t i = bv_widx(g->v->len), k = bv_bidx(g->v->len);
+    g->v->data[i] |= x << k;
+    if (k + n > 64)
+        g->v->data[i + 1] |= x >> (64 - k);
+    g->v->len += n;
+    return g;
+}
+
+struct bv_grow *bv_grow_append(struct bv_grow *g, struct bv const *w)
+{
+    // Appending a vector to itself is fine, but growing may move it.
+    bool self = (w == g->v);
+    size_t len = w->len, n = no_words(len);
+    bv_grow_reserve(g, g->v->len + len);
+    if (self)
+        w = g->v;
+
+    uint64_t *dst = g->v->data + bv_widx(g->v->len);
+    size_t k = bv_bidx(g->v->len);
+    if (k == 0)
+    {
+        // Aligned, and when w is g->v the two ranges don't overlap.
+        memcpy(dst, w->data, n * sizeof(uint64_t));
+    }
+    else
+    {
+        // From the top down, so when w is g->v we have read each word
+        // before we write to it.
+        for (size_t j = n; j-- > 0;)
+        {
+            uint64_t x = w->data[j];
+            if (j + 1 < n || bv_bidx(len) == 0 || k + bv_bidx(len) > 64)
+                dst[j + 1] |= x >> (64 - k);
+            dst[j] |= x << k;
+        }
+    }
+    g->v->len += len;
+    return g;
+}
@@ -0,0 +1,55 @@
+#ifndef BV_GROW_H
+#define BV_GROW_H
+
+#include "bv.h"
+
+// Bit vectors that grow as we append to them.
+//
+// A struct bv has the length it was allocated with. When we build one from
+// a stream, we don't know that length in advance, so here the vector sits
+// in a larger allocation that doubles whenever it is full, making appends
+// amortised O(1) per bit, or per word for the bulk appends.
+//
+// g->v is an ordinary struct bv, with len the number of bits appended so
+// far and the bits beyond it zero, so all the read-only operations in bv.h
+// (and bv_set() on existing bits) work on it directly. Appending can move
+// the vector, so don't hold on to g->v across appends.
+struct bv_grow
+{
+    size_t cap; // bits that fit in the allocation, a multiple of 64
+    struct bv *v;
+};
+
+struct bv_grow *bv_grow_new(size_t cap); // empty, with room for cap bits
+struct bv_grow *bv_grow_from_bv(struct bv const *v);
+void bv_grow_free(struct bv_grow *g);
+
+// Make room for at least cap bits in total.
+struct bv_grow *bv_grow_reserve(struct bv_grow *g, size_t cap);
+// Give back the memory beyond the current length.
+struct bv_grow *bv_grow_shrink(struct bv_grow *g);
+// Shrink the vector, free g, and return the vector. Free it with free().
+struct bv *bv_grow_finish(struct bv_grow *g);
+
+// Append the low n bits of x, n <= 64, at the end, whatever its offset in
+// the last word.
+struct bv_grow *bv_grow_push_bits(struct bv_grow *g, uint64_t x, size_t n);
+struct bv_grow *bv_grow_append(struct bv_grow *g, struct bv const *w);
+
+static inline struct bv_grow *bv_grow_push_word(struct bv_grow *g, uint64_t w)
+{
+    return bv_grow_push_bits(g, w, 64);
+}
+
+// Appending a single bit is the common case, so this one is inline and
+// only calls out when it needs to grow.
+static inline struct bv_grow *bv_grow_push(struct bv_grow *g, bool b)
+{
+    if (g->v->len == g->cap)
+        bv_grow_reserve(g, g->cap + 1);
+    size_t i = g->v->len++;
+    g->v->data[bv_widx(i)] |= (uint64_t)b << bv_bidx(i);
+    return g;
+}
+
+#endif // BV_GROW_H
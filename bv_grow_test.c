@@ -0,0 +1,139 @@
+#include "bv_grow.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The vector must hold the bits in expected, with nothing set beyond them.
+static void check(struct bv_grow const *g, bool const *expected, size_t n)
+{
+    assert(g->v->len == n && n <= g->cap && g->cap % 64 == 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(bv_get(g->v, i) == expected[i]);
+    }
+    for (size_t i = n; i < g->cap; i++)
+    {
+        assert(!bv_get(g->v, i));
+    }
+}
+
+// Append at random, a bit, a word, some bits or a vector at a time, and
+// keep a plain array of the bits alongside.
+static void test_random_appends(void)
+{
+    size_t max = 1 << 16, n = 0;
+    bool *expected = calloc(2 * max, sizeof *expected);
+    assert(expected); // We don't handle allocation errors
+    struct bv_grow *g = bv_grow_new(0);
+    check(g, expected, 0);
+
+    while (n < max)
+    {
+        switch (rng() % 5)
+        {
+        case 0:
+        {
+            bool b = rng() & 1;
+            bv_grow_push(g, b);
+            expected[n++] = b;
+            break;
+        }
+        case 1:
+        {
+            uint64_t w = rng();
+            bv_grow_push_word(g, w);
+            for (size_t i = 0; i < 64; i++)
+            {
+                expected[n++] = (w >> i) & 1;
+            }
+            break;
+        }
+        case 2:
+        {
+            // Garbage above the n bits must not get in.
+            uint64_t x = rng();
+            size_t k = rng() % 65;
+            bv_grow_push_bits(g, x, k);
+            for (size_t i = 0; i < k; i++)
+            {
+                expected[n++] = (x >> i) & 1;
+            }
+            break;
+        }
+        case 3:
+        {
+            struct bv *w = random_vector(rng() % 300);
+            bv_grow_append(g, w);
+            for (size_t i = 0; i < w->len; i++)
+            {
+                expected[n++] = bv_get(w, i);
+            }
+            free(w);
+            break;
+        }
+        case 4:
+            if (n > 2000)
+                break;
+            // Appending to itself, when the vector may move under us.
+            for (size_t i = 0, len = n; i < len; i++)
+            {
+                expected[n++] = expected[i];
+            }
+            bv_grow_append(g, g->v);
+            break;
+        }
+        check(g, expected, n);
+    }
+
+    bv_grow_shrink(g);
+    assert(g->cap == 64 * ((n + 63) / 64));
+    check(g, expected, n);
+    bv_grow_push(g, true); // and it still grows
+    expected[n++] = true;
+    check(g, expected, n);
+
+    struct bv *v = bv_grow_finish(g);
+    assert(v->len == n);
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(bv_get(v, i) == expected[i]);
+    }
+    free(v);
+    free(expected);
+}
+
+static void test_from_bv(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 200};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        struct bv *v = random_vector(sizes[s]);
+        struct bv_grow *g = bv_grow_from_bv(v);
+        assert(bv_eq(g->v, v));
+
+        // The result works with the ordinary operations.
+        struct bv *w = random_vector(sizes[s]);
+        bv_grow_append(g, w);
+        bv_grow_reserve(g, 10000);
+        assert(g->cap >= 10000 && g->v->len == 2 * sizes[s]);
+        struct bv *u = bv_new(2 * sizes[s]);
+        bv_copy_bits(u, 0, v, 0, sizes[s]);
+        bv_copy_bits(u, sizes[s], w, 0, sizes[s]);
+        assert(bv_eq(g->v, u));
+        assert(bv_count_range(g->v, 0, g->v->len) == bv_count_range(u, 0, u->len));
+
+        free(u);
+        free(v);
+        free(w);
+        bv_grow_free(g);
+    }
+}
+
+int main(void)
+{
+    test_random_appends();
+    test_from_bv();
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef BV_KERNELS_H
+#define BV_KERNELS_H
+
+// Internal header: the word-array kernels behind the bulk operations in bv.c.
+// They work on raw arrays of n words, and the table is filled in with the
+// best versions the CPU supports when the library is loaded.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct bv_kernels
+{
+    void (*or_words)(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n);
+    void (*and_words)(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n);
+    void (*not_words)(uint64_t *dst, uint64_t const *a, size_t n);
+    void (*fill_words)(uint64_t *dst, uint64_t w, size_t n);
+    void (*copy_words)(uint64_t *dst, uint64_t const *a, size_t n);
+    bool (*eq_words)(uint64_t const *a, uint64_t const *b, size_t n);
+    void (*xor_words)(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n);
+    void (*andnot_words)(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n); // a & ~b
+    size_t (*count_words)(uint64_t const *a, size_t n); // number of set bits
+    // Pack n bytes into bits, one where the byte isn't `zero`, into
+    // (n + 63) / 64 words with the bits beyond n cleared, and back again,
+    // writing `zero` or `one` for each bit.
+    void (*pack_bytes)(uint64_t *dst, unsigned char const *src, size_t n, unsigned char zero);
+    void (*unpack_bytes)(unsigned char *dst, uint64_t const *src, size_t n,
+                         unsigned char zero, unsigned char one);
+};
+
+extern struct bv_kernels bv_kernels;
+
+#endif // BV_KERNELS_H
@@ -0,0 +1,471 @@
+#include "bv_par.h"
+#include "bv_kernels.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define RSHIFT(W, K) (((K) < 64) ? ((W) >> (K)) : 0)
+#define LSHIFT(W, K) (((K) < 64) ? ((W) << (K)) : 0)
+
+// Below this many bits (16 MiB of words) the threads cost more than they save.
+#define DEFAULT_THRESHOLD ((size_t)1 << 27)
+
+static inline size_t no_words(size_t no_bits)
+{
+    return (no_bits + 63) / 64;
+}
+
+// Zero the bits beyond the end, as bv_clean() in bv.c.
+static void clean(struct bv *v)
+{
+    size_t k = v->len % 64;
+    if (k)
+        v->data[no_words(v->len) - 1] &= ((uint64_t)1 << k) - 1;
+}
+
+// MARK: Thread pool
+// The workers sleep on `work` until the generation changes, then take tasks
+// from the shared counter until there are none left. The last one to finish
+// wakes up the thread waiting on `done`. The calling thread takes tasks as
+// well, so with n threads we only start n - 1 workers.
+struct pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work, done;
+    unsigned no_workers;
+    pthread_t *workers;
+    bool quit;
+    unsigned long generation, start_generation;
+    unsigned active; // workers still on the current job
+
+    void (*task)(void *ctx, size_t i);
+    void *ctx;
+    size_t n;
+    _Atomic size_t next;
+};
+
+static struct pool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER; // one job at a time
+static bool started;                                          // under job_lock
+static _Atomic size_t threshold = DEFAULT_THRESHOLD;
+
+static void run_tasks(void)
+{
+    size_t i;
+    while ((i = atomic_fetch_add(&pool.next, 1)) < pool.n)
+    {
+        pool.task(pool.ctx, i);
+    }
+}
+
+static void *worker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&pool.lock);
+    unsigned long seen = pool.start_generation;
+    for (;;)
+    {
+        while (!pool.quit && pool.generation == seen)
+        {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        if (pool.quit)
+            break;
+        seen = pool.generation;
+
+        pthread_mutex_unlock(&pool.lock);
+        run_tasks();
+        pthread_mutex_lock(&pool.lock);
+
+        if (--pool.active == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// Both of these must be called with job_lock held.
+static void start_pool(unsigned n)
+{
+    if (n == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cores > 0 ? (unsigned)cores : 1;
+    }
+    pool.workers = malloc((n - 1) * sizeof *pool.workers + 1);
+    assert(pool.workers); // We don't handle allocation errors
+
+    pool.start_generation = pool.generation;
+    pool.no_workers = 0;
+    for (unsigned i = 0; i < n - 1; i++)
+    {
+        // If we can't get all the threads we asked for, we make do.
+        if (pthread_create(&pool.workers[i], NULL, worker, NULL) != 0)
+            break;
+        pool.no_workers++;
+    }
+    started = true;
+}
+
+static void stop_pool(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (unsigned i = 0; i < pool.no_workers; i++)
+    {
+        pthread_join(pool.workers[i], NULL);
+    }
+    free(pool.workers);
+    pool.workers = NULL;
+    pool.no_workers = 0;
+    pool.quit = false;
+    started = false;
+}
+
+unsigned bv_par_threads(unsigned n)
+{
+    pthread_mutex_lock(&job_lock);
+    if (started)
+        stop_pool();
+    start_pool(n);
+    unsigned threads = pool.no_workers + 1;
+    pthread_mutex_unlock(&job_lock);
+    return threads;
+}
+
+size_t bv_par_threshold(size_t len)
+{
+    return atomic_exchange(&threshold, len);
+}
+
+void bv_par_run(size_t n, void (*task)(void *ctx, size_t i), void *ctx)
+{
+    pthread_mutex_lock(&job_lock);
+    if (!started)
+        start_pool(0);
+
+    if (pool.no_workers == 0 || n <= 1)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            task(ctx, i);
+        }
+        pthread_mutex_unlock(&job_lock);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.task = task;
+    pool.ctx = ctx;
+    pool.n = n;
+    atomic_store(&pool.next, 0);
+    pool.active = pool.no_workers;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_tasks();
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active > 0)
+    {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    pthread_mutex_unlock(&job_lock);
+}
+
+// MARK: Chunks
+// We split n words into chunks of `size` words, a multiple of a cache line,
+// with the boundaries on cache lines of the destination, so two threads
+// never write to the same line. The first chunk takes the `lead` words
+// before the first boundary as well.
+struct chunks
+{
+    size_t n, size, lead, count;
+};
+
+#define LINE_WORDS 8 // 64 bytes
+
+// The number of threads a job gets, starting the pool on the first call.
+// The pool may change as soon as we let go of job_lock, but the count only
+// decides how many chunks we cut, and a job runs on the chunks it planned,
+// whatever the pool looks like by then.
+static size_t pool_threads(void)
+{
+    pthread_mutex_lock(&job_lock);
+    if (!started)
+        start_pool(0);
+    size_t threads = pool.no_workers + 1;
+    pthread_mutex_unlock(&job_lock);
+    return threads;
+}
+
+static struct chunks make_chunks(uint64_t const *dst, size_t n)
+{
+    // A few chunks per thread evens out the load if some threads are slow.
+    size_t threads = pool_threads();
+    size_t size = (n + 4 * threads - 1) / (4 * threads);
+    size = (size + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS;
+    if (size == 0)
+        size = LINE_WORDS;
+
+    uintptr_t misalign = (uintptr_t)dst % (LINE_WORDS * sizeof *dst);
+    size_t lead = misalign ? (LINE_WORDS * sizeof *dst - misalign) / sizeof *dst : 0;
+
+    struct chunks ch = {n, size, lead, 1};
+    if (n > lead + size)
+        ch.count += (n - lead - size + size - 1) / size;
+    return ch;
+}
+
+static inline size_t chunk_begin(struct chunks const *ch, size_t c)
+{
+    size_t b = c ? ch->lead + c * ch->size : 0;
+    return b < ch->n ? b : ch->n;
+}
+
+static inline size_t chunk_end(struct chunks const *ch, size_t c)
+{
+    return chunk_begin(ch, c + 1);
+}
+
+// MARK: Jobs
+enum op
+{
+    NOT,
+    OR,
+    AND,
+    COPY,
+    EQ,
+    SHIFT_UP_WORD,     // shift up by less than a word, in place
+    SHIFT_DOWN_WORD,   // shift down by less than a word, in place
+    SHIFT_UP_FROM,     // shift up from a copy
+    SHIFT_DOWN_FROM,   // shift down from a copy
+};
+
+struct job
+{
+    enum op op;
+    struct chunks ch;
+    uint64_t *dst;
+    uint64_t const *a, *b;
+    size_t k, offset;   // for the shifts, in bits and whole words
+    uint64_t *carries;  // the neighbour word of each chunk, for in-place shifts
+    atomic_bool differ; // for eq
+};
+
+static void job_task(void *ctx, size_t c)
+{
+    struct job *job = ctx;
+    size_t b = chunk_begin(&job->ch, c), e = chunk_end(&job->ch, c);
+    size_t n = job->ch.n, k = job->k, offset = job->offset;
+    uint64_t *dst = job->dst;
+    uint64_t const *a = job->a;
+
+    switch (job->op)
+    {
+    case NOT:
+        bv_kernels.not_words(dst + b, a + b, e - b);
+        break;
+    case OR:
+        bv_kernels.or_words(dst + b, a + b, job->b + b, e - b);
+        break;
+    case AND:
+        bv_kernels.and_words(dst + b, a + b, job->b + b, e - b);
+        break;
+    case COPY:
+        bv_kernels.copy_words(dst + b, a + b, e - b);
+        break;
+    case EQ:
+        // Don't bother if another chunk already found a difference.
+        if (!atomic_load(&job->differ) && !bv_kernels.eq_words(a + b, job->b + b, e - b))
+            atomic_store(&job->differ, true);
+        break;
+
+    case SHIFT_UP_WORD:
+    {
+        uint64_t carry = job->carries[c];
+        for (size_t i = b; i < e; i++)
+        {
+            uint64_t u = dst[i];
+            dst[i] = (u << k) | (carry >> (64 - k));
+            carry = u;
+        }
+        break;
+    }
+    case SHIFT_DOWN_WORD:
+        for (size_t i = b; i < e; i++)
+        {
+            uint64_t next = (i + 1 < e) ? dst[i + 1] : job->carries[c];
+            dst[i] = (dst[i] >> k) | (next << (64 - k));
+        }
+        break;
+
+    case SHIFT_UP_FROM:
+        for (size_t i = b; i < e; i++)
+        {
+            uint64_t u = (i >= offset + 1) ? a[i - offset - 1] : 0;
+            uint64_t w = (i >= offset) ? a[i - offset] : 0;
+            dst[i] = RSHIFT(u, 64 - k) | LSHIFT(w, k);
+        }
+        break;
+    case SHIFT_DOWN_FROM:
+        for (size_t i = b; i < e; i++)
+        {
+            uint64_t u = (i + offset < n) ? a[i + offset] : 0;
+            uint64_t w = (i + offset + 1 < n) ? a[i + offset + 1] : 0;
+            dst[i] = RSHIFT(u, k) | LSHIFT(w, 64 - k);
+        }
+        break;
+    }
+}
+
+// Cut the n words of dst into chunks. A job runs on the chunks it planned
+// here, so the shifts can save each chunk's neighbour word in between.
+static void plan_job(struct job *job, uint64_t *dst, size_t n)
+{
+    job->dst = dst;
+    job->ch = make_chunks(dst, n);
+}
+
+static void run_job(struct job *job, enum op op)
+{
+    job->op = op;
+    bv_par_run(job->ch.count, job_task, job);
+}
+
+static inline bool small(size_t len)
+{
+    return len < atomic_load(&threshold);
+}
+
+// MARK: Operations
+struct bv *bv_par_neg(struct bv *v)
+{
+    if (small(v->len))
+        return bv_neg(v);
+
+    struct job job = {.a = v->data};
+    plan_job(&job, v->data, no_words(v->len));
+    run_job(&job, NOT);
+    clean(v);
+    return v;
+}
+
+struct bv *bv_par_or_assign(struct bv *v, struct bv const *w)
+{
+    assert(v->len == w->len);
+    if (small(v->len))
+        return bv_or_assign(v, w);
+
+    struct job job = {.a = v->data, .b = w->data};
+    plan_job(&job, v->data, no_words(v->len));
+    run_job(&job, OR);
+    return v;
+}
+
+struct bv *bv_par_and_assign(struct bv *v, struct bv const *w)
+{
+    assert(v->len == w->len);
+    if (small(v->len))
+        return bv_and_assign(v, w);
+
+    struct job job = {.a = v->data, .b = w->data};
+    plan_job(&job, v->data, no_words(v->len));
+    run_job(&job, AND);
+    return v;
+}
+
+bool bv_par_eq(struct bv const *v, struct bv const *w)
+{
+    if (v->len != w->len)
+        return false;
+    if (small(v->len))
+        return bv_eq(v, w);
+
+    struct job job = {.a = v->data, .b = w->data};
+    atomic_init(&job.differ, false);
+    // eq doesn't write, but the chunks might as well follow v's cache lines.
+    plan_job(&job, (uint64_t *)v->data, no_words(v->len));
+    run_job(&job, EQ);
+    return !atomic_load(&job.differ);
+}
+
+// The shifts read words that other chunks write. When we shift by less than
+// a word, each chunk only needs one word from its neighbour, so we save those
+// before we start and shift in place. When we shift by whole words, the
+// chunks read words far away, so we copy the vector first and shift from
+// the copy into the vector.
+static struct bv *par_shift(struct bv *v, size_t m, bool up)
+{
+    size_t n = no_words(v->len);
+    size_t k = m % 64, offset = m / 64;
+    struct job job = {.k = k, .offset = offset};
+
+    if (offset == 0)
+    {
+        if (k == 0)
+            return v;
+
+        plan_job(&job, v->data, n);
+        job.carries = malloc(job.ch.count * sizeof *job.carries);
+        assert(job.carries); // We don't handle allocation errors
+        for (size_t c = 0; c < job.ch.count; c++)
+        {
+            if (up)
+            {
+                size_t b = chunk_begin(&job.ch, c);
+                job.carries[c] = b > 0 ? v->data[b - 1] : 0;
+            }
+            else
+            {
+                size_t e = chunk_end(&job.ch, c);
+                job.carries[c] = e < n ? v->data[e] : 0;
+            }
+        }
+        run_job(&job, up ? SHIFT_UP_WORD : SHIFT_DOWN_WORD);
+        free(job.carries);
+    }
+    else
+    {
+        uint64_t *copy = malloc(n * sizeof *copy + 1);
+        assert(copy); // We don't handle allocation errors
+        job.a = v->data;
+        plan_job(&job, copy, n);
+        run_job(&job, COPY);
+        job.a = copy;
+        plan_job(&job, v->data, n);
+        run_job(&job, up ? SHIFT_UP_FROM : SHIFT_DOWN_FROM);
+        free(copy);
+    }
+
+    clean(v);
+    return v;
+}
+
+struct bv *bv_par_shift_up(struct bv *v, size_t k)
+{
+    if (small(v->len))
+        return bv_shift_up(v, k);
+    return par_shift(v, k, true);
+}
+
+struct bv *bv_par_shift_down(struct bv *v, size_t k)
+{
+    if (small(v->len))
+        return bv_shift_down(v, k);
+    return par_shift(v, k, false);
+}
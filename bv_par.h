@@ -0,0 +1,37 @@
+#ifndef BV_PAR_H
+#define BV_PAR_H
+
+#include "bv.h"
+
+// Multithreaded versions of the bulk operations, for vectors of many
+// millions of bits. The words are split into cache-line aligned chunks that
+// a pool of threads works through, each chunk running the same SIMD kernels
+// as the single-threaded operations. Vectors shorter than the threshold
+// (bv_par_threshold()) just use the single-threaded operations, since for
+// those starting the threads costs more than it saves.
+//
+// The pool runs one job at a time; concurrent calls from several threads
+// are safe but take turns.
+
+// These work like their counterparts in bv.h and return the modified vector.
+struct bv *bv_par_neg(struct bv *v);
+struct bv *bv_par_or_assign(struct bv *v, struct bv const *w);  // v |= w
+struct bv *bv_par_and_assign(struct bv *v, struct bv const *w); // v &= w
+struct bv *bv_par_shift_up(struct bv *v, size_t k);   // v =<< k
+struct bv *bv_par_shift_down(struct bv *v, size_t k); // v =>> k
+bool bv_par_eq(struct bv const *v, struct bv const *w); // v == w
+
+// Set the number of threads to use, including the calling thread (0 for
+// one per core), and return it. This waits for and replaces the current pool.
+unsigned bv_par_threads(unsigned n);
+
+// Set the length in bits from which the operations above run in parallel,
+// and return the old threshold.
+size_t bv_par_threshold(size_t len);
+
+// Run task(ctx, i) for i in 0, ..., n - 1 on the pool, and wait for them
+// all to finish. The tasks run in no particular order and must not call
+// bv_par_run() (or the operations above) themselves.
+void bv_par_run(size_t n, void (*task)(void *ctx, size_t i), void *ctx);
+
+#endif // BV_PAR_H
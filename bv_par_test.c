@@ -0,0 +1,150 @@
+#include "bv_par.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The sizes span several chunks, with and without a partial last word.
+static size_t sizes[] = {1, 64, 100, 1000, 4096, 10000, 65537};
+#define NO_SIZES (sizeof sizes / sizeof *sizes)
+
+static void test_bulk(void)
+{
+    for (size_t s = 0; s < NO_SIZES; s++)
+    {
+        size_t n = sizes[s];
+        struct bv *v = random_vector(n);
+        struct bv *w = random_vector(n);
+
+        struct bv *expected = bv_or_assign(bv_copy(v), w);
+        struct bv *u = bv_par_or_assign(bv_copy(v), w);
+        assert(bv_eq(u, expected) && bv_par_eq(u, expected));
+        free(expected);
+        free(u);
+
+        expected = bv_and_assign(bv_copy(v), w);
+        u = bv_par_and_assign(bv_copy(v), w);
+        assert(bv_eq(u, expected) && bv_par_eq(u, expected));
+        free(expected);
+        free(u);
+
+        expected = bv_neg(bv_copy(v));
+        u = bv_par_neg(bv_copy(v));
+        assert(bv_eq(u, expected) && bv_par_eq(u, expected));
+        free(expected);
+        free(u);
+
+        // A difference in any one word is found
+        assert(bv_par_eq(v, v));
+        for (size_t i = 0; i < n; i += 997)
+        {
+            u = bv_copy(v);
+            bv_set(u, i, !bv_get(u, i));
+            assert(!bv_par_eq(u, v));
+            free(u);
+        }
+
+        free(v);
+        free(w);
+    }
+}
+
+static void test_shifts(void)
+{
+    for (size_t s = 0; s < NO_SIZES; s++)
+    {
+        size_t n = sizes[s];
+        size_t shifts[] = {0, 1, 5, 63, 64, 65, 130, 1000, n - 1, n, n + 1};
+        for (size_t t = 0; t < sizeof shifts / sizeof *shifts; t++)
+        {
+            size_t k = shifts[t];
+            struct bv *v = random_vector(n);
+
+            struct bv *expected = bv_shift_up(bv_copy(v), k);
+            struct bv *u = bv_par_shift_up(bv_copy(v), k);
+            assert(bv_eq(u, expected));
+            free(expected);
+            free(u);
+
+            expected = bv_shift_down(bv_copy(v), k);
+            u = bv_par_shift_down(bv_copy(v), k);
+            assert(bv_eq(u, expected));
+            free(expected);
+            free(u);
+
+            free(v);
+        }
+    }
+}
+
+static void add_task(void *ctx, size_t i)
+{
+    atomic_fetch_add((_Atomic size_t *)ctx, i + 1);
+}
+
+static void test_run(void)
+{
+    for (size_t n = 0; n < 200; n += 7)
+    {
+        _Atomic size_t sum = 0;
+        bv_par_run(n, add_task, &sum);
+        assert(atomic_load(&sum) == n * (n + 1) / 2);
+    }
+}
+
+// Change the number of threads while another thread runs shifts, which
+// plan their chunks and then run on them.
+static void *shift_in_thread(void *arg)
+{
+    struct bv const *v = arg;
+    for (int i = 0; i < 200; i++)
+    {
+        size_t k = 1 + (size_t)i % 63;
+        struct bv *expected = bv_shift_up(bv_copy(v), k);
+        struct bv *u = bv_par_shift_up(bv_copy(v), k);
+        assert(bv_eq(u, expected));
+        free(expected);
+        free(u);
+    }
+    return NULL;
+}
+
+static void test_resize_while_running(void)
+{
+    struct bv *v = random_vector(100000);
+    pthread_t t;
+    pthread_create(&t, NULL, shift_in_thread, v);
+    for (int i = 0; i < 50; i++)
+    {
+        bv_par_threads(1 + (unsigned)i % 8);
+    }
+    pthread_join(t, NULL);
+    free(v);
+}
+
+int main(void)
+{
+    // Run everything in parallel, with more threads than chunks for the
+    // small vectors, whatever the number of cores.
+    bv_par_threshold(0);
+    unsigned threads[] = {1, 3, 8};
+    for (size_t i = 0; i < sizeof threads / sizeof *threads; i++)
+    {
+        assert(bv_par_threads(threads[i]) == threads[i]);
+        test_bulk();
+        test_shifts();
+        test_run();
+    }
+
+    test_resize_while_running();
+
+    // Below the threshold we get the single-threaded operations.
+    bv_par_threshold((size_t)1 << 40);
+    test_bulk();
+    test_shifts();
+
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include "bv_rank.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// Bits per level in the index. The block counts are stored in 10 bits, so a
+// block must hold at most 1023 bits, and the superblock counts are stored
+// in 32 bits so a top-level chunk must hold less than 2^32 bits.
+#define BLOCK_BITS 512
+#define SUPER_BITS 2048
+#define TOP_BITS ((uint64_t)1 << 32)
+#define SELECT_SAMPLE 8192
+
+#define WORDS_PER_BLOCK (BLOCK_BITS / 64)
+#define WORDS_PER_SUPER (SUPER_BITS / 64)
+#define BLOCKS_PER_SUPER (SUPER_BITS / BLOCK_BITS)
+#define SUPERS_PER_TOP (TOP_BITS / SUPER_BITS)
+
+struct bv_rank
+{
+    struct bv const *v;
+    size_t ones;
+    size_t no_supers; // Superblocks covering v; there is a sentinel after them.
+
+    uint64_t *top;   // Absolute counts, one per 2^32 bits.
+    uint64_t *super; // Relative count (low 32 bits) + three 10-bit block counts.
+
+    size_t no_samples1, no_samples0;
+    uint64_t *samples1; // Superblock holding every SELECT_SAMPLE'th one...
+    uint64_t *samples0; // ...and every SELECT_SAMPLE'th zero.
+};
+
+// MARK: Helpers
+static inline unsigned popcount(uint64_t w)
+{
+    // Compiled to a single POPCNT when the target has it.
+    return (unsigned)__builtin_popcountll(w);
+}
+
+// Index of the k'th set bit in w; k must be less than popcount(w).
+static inline unsigned select_in_word(uint64_t w, unsigned k)
+{
+#ifdef __BMI2__
+    return (unsigned)__builtin_ctzll(_pdep_u64((uint64_t)1 << k, w));
+#else
+    // Find the byte with the bit using the byte-wise prefix popcounts,
+    // then finish off inside the byte.
+    uint64_t s = w - ((w >> 1) & 0x5555555555555555);
+    s = (s & 0x3333333333333333) + ((s >> 2) & 0x3333333333333333);
+    s = ((s + (s >> 4)) & 0x0f0f0f0f0f0f0f0f) * 0x0101010101010101;
+    unsigned byte = 0;
+    while (((s >> (8 * byte)) & 0xff) <= k)
+        byte++;
+    if (byte > 0)
+        k -= (s >> (8 * (byte - 1))) & 0xff;
+    uint64_t b = (w >> (8 * byte)) & 0xff;
+    for (; k > 0; k--)
+        b &= b - 1; // remove the lowest set bit
+    return 8 * byte + (unsigned)__builtin_ctzll(b);
+#endif
+}
+
+// The word at index i, with the bits beyond the end of the vector masked out.
+static inline uint64_t clean_word(struct bv const *v, size_t i)
+{
+    uint64_t w = v->data[i];
+    size_t k = v->len % 64;
+    if (k != 0 && i == bv_widx(v->len))
+    {
+        w &= ((uint64_t)1 << k) - 1;
+    }
+    return w;
+}
+
+static inline size_t ones_before_super(struct bv_rank const *r, size_t s)
+{
+    return r->top[s / SUPERS_PER_TOP] + (uint32_t)r->super[s];
+}
+
+static inline unsigned block_count(uint64_t entry, size_t b)
+{
+    return (entry >> (32 + 10 * b)) & 0x3ff;
+}
+
+// MARK: Construction
+struct bv_rank *bv_rank_new(struct bv const *v)
+{
+    size_t no_words = (v->len + 63) / 64;
+    size_t no_supers = (no_words + WORDS_PER_SUPER - 1) / WORDS_PER_SUPER;
+    size_t max_samples = v->len / SELECT_SAMPLE + 1;
+
+    struct bv_rank *r = malloc(sizeof *r);
+    assert(r); // We don't handle allocation errors
+    r->v = v;
+    r->no_supers = no_supers;
+    r->top = malloc((no_supers / SUPERS_PER_TOP + 1) * sizeof *r->top);
+    r->super = malloc((no_supers + 1) * sizeof *r->super);
+    r->samples1 = malloc(max_samples * sizeof *r->samples1);
+    r->samples0 = malloc(max_samples * sizeof *r->samples0);
+    assert(r->top && r->super && r->samples1 && r->samples0);
+
+    // One pass over the words, filling in all the levels as we go.
+    size_t ones = 0, n1 = 0, n0 = 0;
+    for (size_t s = 0; s <= no_supers; s++)
+    {
+        if (s % SUPERS_PER_TOP == 0)
+        {
+            r->top[s / SUPERS_PER_TOP] = ones;
+        }
+        uint64_t entry = ones - r->top[s / SUPERS_PER_TOP];
+        if (s == no_supers)
+        {
+            r->super[s] = entry; // sentinel
+            break;
+        }
+
+        for (size_t b = 0; b < BLOCKS_PER_SUPER; b++)
+        {
+            size_t from = s * WORDS_PER_SUPER + b * WORDS_PER_BLOCK;
+            size_t to = from + WORDS_PER_BLOCK;
+            unsigned count = 0;
+            for (size_t i = from; i < to && i < no_words; i++)
+            {
+                count += popcount(clean_word(v, i));
+            }
+            if (b < BLOCKS_PER_SUPER - 1)
+            {
+                entry |= (uint64_t)count << (32 + 10 * b);
+            }
+            ones += count;
+        }
+        r->super[s] = entry;
+
+        // Sample the ones and zeros that fall in this superblock.
+        size_t end = (s + 1) * SUPER_BITS < v->len ? (s + 1) * SUPER_BITS : v->len;
+        size_t zeros = end - ones;
+        for (; n1 * SELECT_SAMPLE < ones; n1++)
+        {
+            r->samples1[n1] = s;
+        }
+        for (; n0 * SELECT_SAMPLE < zeros; n0++)
+        {
+            r->samples0[n0] = s;
+        }
+    }
+
+    r->ones = ones;
+    r->no_samples1 = n1;
+    r->no_samples0 = n0;
+
+    // Give back the sample space we didn't need.
+    r->samples1 = realloc(r->samples1, (n1 + 1) * sizeof *r->samples1);
+    r->samples0 = realloc(r->samples0, (n0 + 1) * sizeof *r->samples0);
+    assert(r->samples1 && r->samples0);
+
+    return r;
+}
+
+void bv_rank_free(struct bv_rank *r)
+{
+    free(r->top);
+    free(r->super);
+    free(r->samples1);
+    free(r->samples0);
+    free(r);
+}
+
+size_t bv_rank_ones(struct bv_rank const *r)
+{
+    return r->ones;
+}
+
+size_t bv_rank_bytes(struct bv_rank const *r)
+{
+    return sizeof *r +
+           (r->no_supers / SUPERS_PER_TOP + 1) * sizeof *r->top +
+           (r->no_supers + 1) * sizeof *r->super +
+           (r->no_samples1 + r->no_samples0) * sizeof(uint64_t);
+}
+
+// MARK: Rank
+size_t bv_rank1(struct bv_rank const *r, size_t i)
+{
+    assert(i <= r->v->len);
+    size_t s = i / SUPER_BITS;
+    uint64_t entry = r->super[s];
+    size_t rank = ones_before_super(r, s);
+
+    size_t b = (i % SUPER_BITS) / BLOCK_BITS;
+    for (size_t j = 0; j < b; j++)
+    {
+        rank += block_count(entry, j);
+    }
+
+    // At most seven whole words and then a partial one.
+    uint64_t const *data = r->v->data;
+    for (size_t w = s * WORDS_PER_SUPER + b * WORDS_PER_BLOCK; w < bv_widx(i); w++)
+    {
+        rank += popcount(data[w]);
+    }
+    if (bv_bidx(i) != 0)
+    {
+        rank += popcount(data[bv_widx(i)] & (((uint64_t)1 << bv_bidx(i)) - 1));
+    }
+
+    return rank;
+}
+
+size_t bv_rank0(struct bv_rank const *r, size_t i)
+{
+    return i - bv_rank1(r, i);
+}
+
+// MARK: Select
+
+// The number of ones or zeros before superblock s
+static inline size_t count_before_super(struct bv_rank const *r, size_t s, bool bit)
+{
+    size_t ones = ones_before_super(r, s);
+    return bit ? ones : s * SUPER_BITS - ones;
+}
+
+static size_t select_bit(struct bv_rank const *r, size_t k, bool bit)
+{
+    size_t total = bit ? r->ones : r->v->len - r->ones;
+    if (k >= total)
+        return r->v->len;
+
+    // The samples narrow the search down to a range of superblocks, and
+    // we binary search for the last one that starts at or before the k'th bit.
+    uint64_t const *samples = bit ? r->samples1 : r->samples0;
+    size_t no_samples = bit ? r->no_samples1 : r->no_samples0;
+    size_t j = k / SELECT_SAMPLE;
+    size_t lo = samples[j];
+    size_t hi = (j + 1 < no_samples) ? samples[j + 1] : r->no_supers - 1;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (count_before_super(r, mid, bit) <= k)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    size_t s = lo;
+    k -= count_before_super(r, s, bit);
+
+    // Then the block...
+    uint64_t entry = r->super[s];
+    size_t b = 0;
+    for (; b < BLOCKS_PER_SUPER - 1; b++)
+    {
+        unsigned count = block_count(entry, b);
+        if (!bit)
+            count = BLOCK_BITS - count;
+        if (k < count)
+            break;
+        k -= count;
+    }
+
+    // ...and finally the word.
+    uint64_t const *data = r->v->data;
+    for (size_t w = s * WORDS_PER_SUPER + b * WORDS_PER_BLOCK;; w++)
+    {
+        uint64_t word = bit ? data[w] : ~data[w];
+        unsigned count = popcount(word);
+        if (k < count)
+            return 64 * w + select_in_word(word, (unsigned)k);
+        k -= count;
+    }
+}
+
+size_t bv_select1(struct bv_rank const *r, size_t k)
+{
+    return select_bit(r, k, true);
+}
+
+size_t bv_select0(struct bv_rank const *r, size_t k)
+{
+    return select_bit(r, k, false);
+}
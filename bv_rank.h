@@ -0,0 +1,39 @@
+#ifndef BV_RANK_H
+#define BV_RANK_H
+
+#include "bv.h"
+
+// A rank/select index over a bit vector. The index only holds counts, not
+// the bits themselves, so the vector must outlive the index and must not be
+// modified while the index is in use. Once built the index is never written
+// to again, so it is safe to share between threads.
+//
+// The layout is the "poppy" layout (Zhou, Andersen and Kaminsky, 2013):
+//
+//  - a top level of absolute 64-bit counts, one per 2^32 bits;
+//  - one 64-bit word per 2048-bit superblock, holding the (32-bit) count
+//    relative to the top level in the low bits and the popcounts of the first
+//    three 512-bit blocks (10 bits each) in the high bits, so the superblock
+//    and block counts sit interleaved in the same cache line;
+//  - the superblock of every 8192'th one (and zero) for select.
+//
+// This comes to a little over 3% of the vector's size for the rank counts,
+// plus at most 1.6% for the select samples.
+struct bv_rank;
+
+struct bv_rank *bv_rank_new(struct bv const *v);
+void bv_rank_free(struct bv_rank *r);
+
+size_t bv_rank_ones(struct bv_rank const *r);  // total number of ones
+size_t bv_rank_bytes(struct bv_rank const *r); // size of the index
+
+// Number of ones (zeros) in v[0:i], for 0 <= i <= v->len.
+size_t bv_rank1(struct bv_rank const *r, size_t i);
+size_t bv_rank0(struct bv_rank const *r, size_t i);
+
+// Position of the k'th one (zero), counting from zero. Returns v->len if
+// there are not that many ones (zeros) in the vector.
+size_t bv_select1(struct bv_rank const *r, size_t k);
+size_t bv_select0(struct bv_rank const *r, size_t k);
+
+#endif // BV_RANK_H
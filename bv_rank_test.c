@@ -0,0 +1,109 @@
+#include "bv_rank.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Vector of length n where each bit is set with probability 1/density
+// (density 0 gives all zeros and density 1 all ones).
+static struct bv *random_vector_density(size_t n, unsigned density)
+{
+    struct bv *v = bv_new(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        bv_set(v, i, density != 0 && rng() % density == 0);
+    }
+    return v;
+}
+
+// Compare the index against a straightforward scan of the vector.
+static void check_against_scan(struct bv *v)
+{
+    struct bv_rank *r = bv_rank_new(v);
+
+    size_t ones = 0;
+    for (size_t i = 0; i < v->len; i++)
+    {
+        assert(bv_rank1(r, i) == ones);
+        assert(bv_rank0(r, i) == i - ones);
+        if (bv_get(v, i))
+        {
+            assert(bv_select1(r, ones) == i);
+            ones++;
+        }
+        else
+        {
+            assert(bv_select0(r, i - ones) == i);
+        }
+    }
+    assert(bv_rank1(r, v->len) == ones);
+    assert(bv_rank_ones(r) == ones);
+    assert(bv_select1(r, ones) == v->len);
+    assert(bv_select0(r, v->len - ones) == v->len);
+
+    bv_rank_free(r);
+}
+
+static void test_sizes(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 511, 512, 513, 2047, 2048, 2049, 10000};
+    unsigned densities[] = {0, 1, 2, 7, 100};
+    for (size_t i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+        for (size_t j = 0; j < sizeof densities / sizeof *densities; j++)
+        {
+            struct bv *v = random_vector_density(sizes[i], densities[j]);
+            check_against_scan(v);
+            free(v);
+        }
+    }
+}
+
+static void test_select_samples(void)
+{
+    // Long enough to get many select samples, both with sparse
+    // ones (samples far apart) and dense ones (samples close together).
+    unsigned densities[] = {2, 50, 5000};
+    for (size_t j = 0; j < sizeof densities / sizeof *densities; j++)
+    {
+        struct bv *v = random_vector_density(300001, densities[j]);
+        check_against_scan(v);
+        free(v);
+    }
+}
+
+static void test_dirty_tail(void)
+{
+    // Bits beyond the end of the vector must not be counted.
+    struct bv *v = bv_one(bv_new(70));
+    v->data[1] = ~(uint64_t)0;
+    struct bv_rank *r = bv_rank_new(v);
+    assert(bv_rank_ones(r) == 70);
+    assert(bv_rank1(r, 70) == 70);
+    assert(bv_select1(r, 69) == 69);
+    assert(bv_select1(r, 70) == 70);
+    bv_rank_free(r);
+    free(v);
+}
+
+static void test_size(void)
+{
+    // The index should only be a few percent of the vector.
+    size_t n = 10000000;
+    struct bv *v = random_vector_density(n, 2);
+    struct bv_rank *r = bv_rank_new(v);
+    assert(bv_rank_bytes(r) * 100 < (n / 8) * 5);
+    bv_rank_free(r);
+    free(v);
+}
+
+int main(void)
+{
+    test_sizes();
+    test_select_samples();
+    test_dirty_tail();
+    test_size();
+
+    return 0;
+}
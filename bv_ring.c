@@ -0,0 +1,204 @@
+#include "bv_ring.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+struct bv_ring
+{
+    size_t len;
+    size_t no_words; // in the ring, one more than the vector needs
+    size_t head;     // the ring word holding the first bits
+    size_t offset;   // bit 0 of the vector is bit `offset` of the head word
+    uint64_t data[];
+};
+
+static inline size_t no_words(size_t no_bits)
+{
+    return (no_bits + 63) / 64;
+}
+
+// Word j of the ring, counted from the head. Bit b of the ring, counted
+// the same way, holds bit b - offset of the vector.
+static inline uint64_t *ring_word(struct bv_ring *r, size_t j)
+{
+    size_t k = r->head + j;
+    return &r->data[k < r->no_words ? k : k - r->no_words];
+}
+
+static inline uint64_t ring_word_const(struct bv_ring const *r, size_t j)
+{
+    size_t k = r->head + j;
+    return r->data[k < r->no_words ? k : k - r->no_words];
+}
+
+// The bits [from, to) of the ring, counted from the head.
+static void ring_clear(struct bv_ring *r, size_t from, size_t to)
+{
+    while (from < to)
+    {
+        size_t k = from % 64;
+        size_t n = (to - from < 64 - k) ? to - from : 64 - k;
+        uint64_t mask = (n == 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1) << k;
+        *ring_word(r, from / 64) &= ~mask;
+        from += n;
+    }
+}
+
+// MARK: Construction
+struct bv_ring *bv_ring_new(size_t len)
+{
+    size_t n = no_words(len) + 1;
+    struct bv_ring *r = calloc(1, offsetof(struct bv_ring, data) + n * sizeof(uint64_t));
+    assert(r); // We don't handle allocation errors
+    r->len = len;
+    r->no_words = n;
+    return r;
+}
+
+struct bv_ring *bv_ring_from_bv(struct bv const *v)
+{
+    struct bv_ring *r = bv_ring_new(v->len);
+    memcpy(r->data, v->data, no_words(v->len) * sizeof(uint64_t));
+    return r;
+}
+
+uint64_t bv_ring_word(struct bv_ring const *r, size_t i)
+{
+    size_t k = r->offset;
+    uint64_t lo = ring_word_const(r, i) >> k;
+    uint64_t hi = k ? ring_word_const(r, i + 1) << (64 - k) : 0;
+    return lo | hi;
+}
+
+struct bv *bv_ring_to_bv(struct bv_ring const *r, struct bv *v)
+{
+    assert(v->len == r->len);
+    for (size_t i = 0; i < no_words(r->len); i++)
+    {
+        v->data[i] = bv_ring_word(r, i);
+    }
+    return v;
+}
+
+// MARK: Bits
+size_t bv_ring_len(struct bv_ring const *r)
+{
+    return r->len;
+}
+
+bool bv_ring_get(struct bv_ring const *r, size_t i)
+{
+    assert(i < r->len);
+    size_t b = i + r->offset;
+    return !!((ring_word_const(r, b / 64) >> (b % 64)) & 1);
+}
+
+struct bv_ring *bv_ring_set(struct bv_ring *r, size_t i, bool b)
+{
+    assert(i < r->len);
+    size_t k = i + r->offset;
+    uint64_t *w = ring_word(r, k / 64);
+    uint64_t mask = (uint64_t)1 << (k % 64);
+    *w = b ? (*w | mask) : (*w & ~mask);
+    return r;
+}
+
+// MARK: Shifts
+struct bv_ring *bv_ring_shift_up(struct bv_ring *r, size_t k)
+{
+    if (k >= r->len)
+    {
+        memset(r->data, 0, r->no_words * sizeof(uint64_t));
+        r->head = r->offset = 0;
+        return r;
+    }
+
+    // The bits that fall off the top are cleared, so they are zeros when
+    // they come back in, at the top after a shift down or at the bottom
+    // when we move the head down below.
+    ring_clear(r, r->len - k + r->offset, r->len + r->offset);
+
+    // Moving the start k bits down, a word at a time while the offset
+    // can't absorb it.
+    while (k > r->offset)
+    {
+        r->head = r->head ? r->head - 1 : r->no_words - 1;
+        r->offset += 64;
+    }
+    r->offset -= k;
+
+    return r;
+}
+
+struct bv_ring *bv_ring_shift_down(struct bv_ring *r, size_t k)
+{
+    if (k >= r->len)
+    {
+        memset(r->data, 0, r->no_words * sizeof(uint64_t));
+        r->head = r->offset = 0;
+        return r;
+    }
+
+    // The bits that fall off the bottom are cleared, and so the words we
+    // move the head past are all zero when they wrap around to the top.
+    ring_clear(r, r->offset, r->offset + k);
+
+    r->offset += k;
+    size_t words = r->offset / 64;
+    r->head = (r->head + words) % r->no_words;
+    r->offset %= 64;
+
+    return r;
+}
+
+// MARK: Operations
+// Ring word j holds the top bits of word j - 1 of the vector and the bottom
+// bits of word j, so we combine with the same two words of w shifted into
+// place, carrying the previous word of w between iterations. We walk the
+// ring with an index that wraps, rather than taking a remainder per word.
+// clang-format off
+#define EACH_RING_WORD(R, W, ...)                                                \
+    do                                                                           \
+    {                                                                            \
+        size_t k_ = (R)->offset, n_ = no_words((W)->len), p_ = (R)->head;        \
+        uint64_t prev_ = 0;                                                      \
+        for (size_t j_ = 0; j_ <= n_; j_++)                                      \
+        {                                                                        \
+            uint64_t cur_ = (j_ < n_) ? (W)->data[j_] : 0;                       \
+            uint64_t x_ = (cur_ << k_) | (k_ ? prev_ >> (64 - k_) : 0);          \
+            uint64_t *word_ = &(R)->data[p_];                                    \
+            __VA_ARGS__;                                                         \
+            prev_ = cur_;                                                        \
+            p_ = (p_ + 1 == (R)->no_words) ? 0 : p_ + 1;                         \
+        }                                                                        \
+    } while (0)
+// clang-format on
+
+struct bv_ring *bv_ring_or_assign(struct bv_ring *r, struct bv const *w)
+{
+    assert(r->len == w->len);
+    // Bits beyond the end of w are zero, so this sets no bits outside the
+    // vector.
+    EACH_RING_WORD(r, w, *word_ |= x_);
+    return r;
+}
+
+struct bv_ring *bv_ring_and_assign(struct bv_ring *r, struct bv const *w)
+{
+    assert(r->len == w->len);
+    EACH_RING_WORD(r, w, *word_ &= x_);
+    return r;
+}
+
+bool bv_ring_eq(struct bv_ring const *r, struct bv const *w)
+{
+    if (r->len != w->len)
+        return false;
+    for (size_t i = 0; i < no_words(r->len); i++)
+    {
+        if (bv_ring_word(r, i) != w->data[i])
+            return false;
+    }
+    return true;
+}
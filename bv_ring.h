@@ -0,0 +1,44 @@
+#ifndef BV_RING_H
+#define BV_RING_H
+
+#include "bv.h"
+
+// Bit vectors where shifting doesn't move the words.
+//
+// bv_shift_up() and bv_shift_down() rewrite every word of the vector, even
+// when we shift by a single bit, as SHIFT-and-OR does for every character.
+// Here the words form a ring, and the vector starts at a bit offset inside
+// it: the word at the head of the ring plus an offset of 0 to 63 bits.
+// Shifting by k bits just moves the offset, and when it passes a word
+// boundary, the head. The only words we touch are the (about k / 64) words
+// whose bits fall off one end, which we clear so they can come back in at
+// the other. The remaining sub-word offset is applied when we read the
+// vector or combine it with another, which we have to go through the words
+// for anyway.
+//
+// The ring has one word more than the vector needs, so the bits fit at any
+// offset. All bits of the ring outside the vector are kept zero, so bits
+// shifted in from either end are zeros.
+struct bv_ring;
+
+struct bv_ring *bv_ring_new(size_t len); // all zeros; free with free()
+struct bv_ring *bv_ring_from_bv(struct bv const *v);
+struct bv *bv_ring_to_bv(struct bv_ring const *r, struct bv *v); // v = r; same length
+
+size_t bv_ring_len(struct bv_ring const *r);
+bool bv_ring_get(struct bv_ring const *r, size_t i);
+struct bv_ring *bv_ring_set(struct bv_ring *r, size_t i, bool b);
+// Word i of the vector, bits 64 * i to 64 * i + 63.
+uint64_t bv_ring_word(struct bv_ring const *r, size_t i);
+
+// These are O(k / 64), not O(len / 64), and return the ring.
+struct bv_ring *bv_ring_shift_up(struct bv_ring *r, size_t k);   // r =<< k
+struct bv_ring *bv_ring_shift_down(struct bv_ring *r, size_t k); // r =>> k
+
+// Combining with a plain vector of the same length applies the offset on
+// the fly, in the same pass.
+struct bv_ring *bv_ring_or_assign(struct bv_ring *r, struct bv const *w);  // r |= w
+struct bv_ring *bv_ring_and_assign(struct bv_ring *r, struct bv const *w); // r &= w
+bool bv_ring_eq(struct bv_ring const *r, struct bv const *w);              // r == w
+
+#endif // BV_RING_H
@@ -0,0 +1,106 @@
+#include "bv_ring.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void check(struct bv_ring const *r, struct bv const *v)
+{
+    assert(bv_ring_len(r) == v->len);
+    assert(bv_ring_eq(r, v));
+    for (size_t i = 0; i < v->len; i++)
+    {
+        assert(bv_ring_get(r, i) == bv_get(v, i));
+    }
+    struct bv *u = bv_ring_to_bv(r, bv_new(v->len));
+    assert(bv_eq(u, v));
+    free(u);
+}
+
+// Run random operations on a ring and a plain vector side by side.
+static void test_random_ops(size_t n)
+{
+    struct bv *v = random_vector(n);
+    struct bv_ring *r = bv_ring_from_bv(v);
+    check(r, v);
+
+    for (int step = 0; step < 500; step++)
+    {
+        // Mostly small shifts, as in a scan, but some longer ones too.
+        size_t k = (rng() % 4 == 0) ? rng() % (n + 70) : rng() % 3;
+        struct bv *w;
+        switch (rng() % 6)
+        {
+        case 0:
+            bv_shift_up(v, k);
+            bv_ring_shift_up(r, k);
+            break;
+        case 1:
+            bv_shift_down(v, k);
+            bv_ring_shift_down(r, k);
+            break;
+        case 2:
+            w = random_vector(n);
+            bv_or_assign(v, w);
+            bv_ring_or_assign(r, w);
+            free(w);
+            break;
+        case 3:
+            // Mostly ones, so the vectors don't go all zero.
+            w = bv_one(bv_new(n));
+            for (size_t i = 0; i < n / 8 + 1; i++)
+            {
+                bv_set(w, rng() % n, 0);
+            }
+            bv_and_assign(v, w);
+            bv_ring_and_assign(r, w);
+            free(w);
+            break;
+        case 4:
+        {
+            size_t i = rng() % n;
+            bool b = rng() & 1;
+            bv_set(v, i, b);
+            bv_ring_set(r, i, b);
+            break;
+        }
+        case 5:
+            // The SHIFT-and-OR step
+            w = random_vector(n);
+            bv_shift_up_or_assign(v, 1, w);
+            bv_ring_or_assign(bv_ring_shift_up(r, 1), w);
+            free(w);
+            break;
+        }
+        check(r, v);
+    }
+
+    free(v);
+    free(r);
+}
+
+static void test_word(void)
+{
+    struct bv *v = random_vector(300);
+    struct bv_ring *r = bv_ring_from_bv(v);
+    bv_ring_shift_up(r, 70);
+    bv_shift_up(v, 70);
+    for (size_t i = 0; i < 5; i++)
+    {
+        assert(bv_ring_word(r, i) == v->data[i]);
+    }
+    free(v);
+    free(r);
+}
+
+int main(void)
+{
+    size_t sizes[] = {1, 2, 63, 64, 65, 128, 200, 1000};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        test_random_ops(sizes[s]);
+    }
+    test_word();
+    return 0;
+}
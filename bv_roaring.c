@@ -0,0 +1,669 @@
+#include "bv_roaring.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK_BITS 65536
+#define CHUNK_WORDS (CHUNK_BITS / 64)
+#define ARRAY_MAX 4096 // above this, an array is larger than a bitmap
+
+enum container_type
+{
+    ARRAY,
+    BITMAP,
+    RUN,
+};
+
+struct run
+{
+    uint16_t start, last; // inclusive, so a run can cover a whole chunk
+};
+
+struct container
+{
+    enum container_type type;
+    uint32_t card; // number of set bits
+    uint32_t n;    // number of values (ARRAY) or runs (RUN)
+    union
+    {
+        uint16_t *values;  // ARRAY: sorted positions of set bits
+        uint64_t *words;   // BITMAP: CHUNK_WORDS words
+        struct run *runs;  // RUN: sorted, non-overlapping, non-adjacent runs
+    };
+};
+
+struct bv_roaring
+{
+    size_t len;
+    size_t n, cap;
+    uint32_t *keys; // chunk index (position >> 16) of each container
+    struct container *cs;
+};
+
+// MARK: Helpers
+static inline unsigned popcount(uint64_t w)
+{
+    return (unsigned)__builtin_popcountll(w);
+}
+
+static void *checked_malloc(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+    assert(p); // We don't handle allocation errors
+    return p;
+}
+
+static inline void set_bit(uint64_t *words, unsigned i)
+{
+    words[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+static inline bool get_bit(uint64_t const *words, unsigned i)
+{
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+// Set bits [start, last] in words.
+static void set_run(uint64_t *words, unsigned start, unsigned last)
+{
+    unsigned first_word = start / 64, last_word = last / 64;
+    uint64_t first_mask = ~(uint64_t)0 << (start % 64);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - last % 64);
+    if (first_word == last_word)
+    {
+        words[first_word] |= first_mask & last_mask;
+        return;
+    }
+    words[first_word] |= first_mask;
+    for (unsigned i = first_word + 1; i < last_word; i++)
+        words[i] = ~(uint64_t)0;
+    words[last_word] |= last_mask;
+}
+
+static struct bv_roaring *roaring_new(size_t len)
+{
+    // Keys are 32 bits, which limits us to 2^48 bits.
+    assert((uint64_t)len / CHUNK_BITS < ((uint64_t)1 << 32));
+    struct bv_roaring *r = checked_malloc(sizeof *r);
+    r->len = len;
+    r->n = 0;
+    r->cap = 4;
+    r->keys = checked_malloc(r->cap * sizeof *r->keys);
+    r->cs = checked_malloc(r->cap * sizeof *r->cs);
+    return r;
+}
+
+// Append a container; keys must come in increasing order.
+// Empty containers are dropped.
+static void roaring_push(struct bv_roaring *r, uint32_t key, struct container c)
+{
+    if (c.card == 0)
+    {
+        free(c.values);
+        return;
+    }
+    if (r->n == r->cap)
+    {
+        r->cap *= 2;
+        r->keys = realloc(r->keys, r->cap * sizeof *r->keys);
+        r->cs = realloc(r->cs, r->cap * sizeof *r->cs);
+        assert(r->keys && r->cs);
+    }
+    r->keys[r->n] = key;
+    r->cs[r->n] = c;
+    r->n++;
+}
+
+// MARK: Containers
+static size_t container_bytes(struct container const *c)
+{
+    switch (c->type)
+    {
+    case ARRAY:
+        return c->n * sizeof *c->values;
+    case BITMAP:
+        return CHUNK_WORDS * sizeof *c->words;
+    case RUN:
+        return c->n * sizeof *c->runs;
+    }
+    return 0;
+}
+
+static struct container container_copy(struct container const *c)
+{
+    struct container d = *c;
+    size_t bytes = container_bytes(c);
+    d.values = checked_malloc(bytes);
+    memcpy(d.values, c->values, bytes);
+    return d;
+}
+
+static bool container_get(struct container const *c, uint16_t x)
+{
+    switch (c->type)
+    {
+    case ARRAY:
+    {
+        size_t lo = 0, hi = c->n;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (c->values[mid] < x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo < c->n && c->values[lo] == x;
+    }
+    case BITMAP:
+        return get_bit(c->words, x);
+    case RUN:
+    {
+        // The last run starting at or before x
+        size_t lo = 0, hi = c->n;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (c->runs[mid].start <= x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo > 0 && x <= c->runs[lo - 1].last;
+    }
+    }
+    return false;
+}
+
+// words |= c
+static void container_or_words(struct container const *c, uint64_t *words);
+
+// Expand any container into a bitmap of CHUNK_WORDS words.
+static void container_to_words(struct container const *c, uint64_t *words)
+{
+    if (c->type == BITMAP)
+    {
+        memcpy(words, c->words, CHUNK_WORDS * sizeof *words);
+        return;
+    }
+    memset(words, 0, CHUNK_WORDS * sizeof *words);
+    container_or_words(c, words);
+}
+
+// Build the smallest container for the bits in words (CHUNK_WORDS of them).
+static struct container container_from_words(uint64_t const *words)
+{
+    uint32_t card = 0, no_runs = 0;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < CHUNK_WORDS; i++)
+    {
+        uint64_t w = words[i];
+        card += popcount(w);
+        no_runs += popcount(w & ~((w << 1) | carry)); // bits starting a run
+        carry = w >> 63;
+    }
+
+    struct container c = {.card = card};
+    size_t array_bytes = card <= ARRAY_MAX ? card * sizeof(uint16_t) : SIZE_MAX;
+    size_t bitmap_bytes = CHUNK_WORDS * sizeof(uint64_t);
+    size_t run_bytes = no_runs * sizeof(struct run);
+
+    if (run_bytes < array_bytes && run_bytes < bitmap_bytes)
+    {
+        c.type = RUN;
+        c.n = 0;
+        c.runs = checked_malloc(run_bytes);
+        unsigned i = 0;
+        while (c.n < no_runs)
+        {
+            // Skip to the next set bit, then to the next clear bit.
+            while (!(words[i / 64] >> (i % 64)))
+                i = (i / 64 + 1) * 64;
+            i += (unsigned)__builtin_ctzll(words[i / 64] >> (i % 64));
+            unsigned start = i;
+            while (i < CHUNK_BITS && !(~words[i / 64] >> (i % 64)))
+                i = (i / 64 + 1) * 64;
+            if (i < CHUNK_BITS)
+                i += (unsigned)__builtin_ctzll(~words[i / 64] >> (i % 64));
+            c.runs[c.n++] = (struct run){(uint16_t)start, (uint16_t)(i - 1)};
+        }
+    }
+    else if (array_bytes <= bitmap_bytes)
+    {
+        c.type = ARRAY;
+        c.n = 0;
+        c.values = checked_malloc(array_bytes);
+        for (size_t i = 0; i < CHUNK_WORDS; i++)
+        {
+            for (uint64_t w = words[i]; w; w &= w - 1)
+                c.values[c.n++] = (uint16_t)(64 * i + (size_t)__builtin_ctzll(w));
+        }
+    }
+    else
+    {
+        c.type = BITMAP;
+        c.n = 0;
+        c.words = checked_malloc(bitmap_bytes);
+        memcpy(c.words, words, bitmap_bytes);
+    }
+    return c;
+}
+
+static void container_or_words(struct container const *c, uint64_t *words)
+{
+    switch (c->type)
+    {
+    case ARRAY:
+        for (size_t i = 0; i < c->n; i++)
+            set_bit(words, c->values[i]);
+        break;
+    case BITMAP:
+        for (size_t i = 0; i < CHUNK_WORDS; i++)
+            words[i] |= c->words[i];
+        break;
+    case RUN:
+        for (size_t i = 0; i < c->n; i++)
+            set_run(words, c->runs[i].start, c->runs[i].last);
+        break;
+    }
+}
+
+// Keep the values of array container a that are also in c.
+static struct container array_and(struct container const *a, struct container const *c)
+{
+    struct container r = {.type = ARRAY, .card = 0, .n = 0};
+    r.values = checked_malloc(a->n * sizeof *r.values);
+    if (c->type == ARRAY)
+    {
+        // Merge the two sorted arrays
+        for (size_t i = 0, j = 0; i < a->n && j < c->n;)
+        {
+            if (a->values[i] < c->values[j])
+                i++;
+            else if (a->values[i] > c->values[j])
+                j++;
+            else
+                r.values[r.n++] = a->values[i++], j++;
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < a->n; i++)
+            if (container_get(c, a->values[i]))
+                r.values[r.n++] = a->values[i];
+    }
+    r.card = r.n;
+    return r;
+}
+
+static struct container array_or(struct container const *a, struct container const *b)
+{
+    struct container r = {.type = ARRAY, .n = 0};
+    r.values = checked_malloc((a->n + b->n) * sizeof *r.values);
+    size_t i = 0, j = 0;
+    while (i < a->n && j < b->n)
+    {
+        if (a->values[i] < b->values[j])
+            r.values[r.n++] = a->values[i++];
+        else if (a->values[i] > b->values[j])
+            r.values[r.n++] = b->values[j++];
+        else
+            r.values[r.n++] = a->values[i++], j++;
+    }
+    while (i < a->n)
+        r.values[r.n++] = a->values[i++];
+    while (j < b->n)
+        r.values[r.n++] = b->values[j++];
+    r.card = r.n;
+    return r;
+}
+
+// The run containers can be combined without expanding them, by merging
+// the sorted runs. The result may be better off as another container type,
+// which the caller sorts out.
+static struct container run_and(struct container const *a, struct container const *b)
+{
+    struct container r = {.type = RUN, .card = 0, .n = 0};
+    r.runs = checked_malloc((a->n + b->n) * sizeof *r.runs);
+    for (size_t i = 0, j = 0; i < a->n && j < b->n;)
+    {
+        unsigned start = a->runs[i].start > b->runs[j].start ? a->runs[i].start : b->runs[j].start;
+        unsigned last = a->runs[i].last < b->runs[j].last ? a->runs[i].last : b->runs[j].last;
+        if (start <= last)
+        {
+            r.runs[r.n++] = (struct run){(uint16_t)start, (uint16_t)last};
+            r.card += last - start + 1;
+        }
+        // Move past the run that ends first.
+        if (a->runs[i].last < b->runs[j].last)
+            i++;
+        else
+            j++;
+    }
+    return r;
+}
+
+static struct container run_or(struct container const *a, struct container const *b)
+{
+    struct container r = {.type = RUN, .card = 0, .n = 0};
+    r.runs = checked_malloc((a->n + b->n) * sizeof *r.runs);
+    size_t i = 0, j = 0;
+    while (i < a->n || j < b->n)
+    {
+        struct run next;
+        if (j == b->n || (i < a->n && a->runs[i].start <= b->runs[j].start))
+            next = a->runs[i++];
+        else
+            next = b->runs[j++];
+
+        // Extend the previous run if the two overlap or touch.
+        struct run *prev = r.n ? &r.runs[r.n - 1] : NULL;
+        if (prev && (unsigned)next.start <= (unsigned)prev->last + 1)
+        {
+            if (next.last > prev->last)
+                prev->last = next.last;
+        }
+        else
+        {
+            r.runs[r.n++] = next;
+        }
+    }
+    for (size_t k = 0; k < r.n; k++)
+        r.card += (uint32_t)(r.runs[k].last - r.runs[k].start + 1);
+    return r;
+}
+
+// Convert c to the smallest container type, if it isn't already.
+static struct container container_compact(struct container c)
+{
+    size_t array_bytes = c.card <= ARRAY_MAX ? c.card * sizeof(uint16_t) : SIZE_MAX;
+    size_t bitmap_bytes = CHUNK_WORDS * sizeof(uint64_t);
+    size_t bytes = container_bytes(&c);
+    if (c.card == 0 || (bytes <= array_bytes && bytes <= bitmap_bytes))
+        return c;
+
+    uint64_t words[CHUNK_WORDS];
+    container_to_words(&c, words);
+    free(c.values);
+    return container_from_words(words);
+}
+
+static struct container container_and(struct container const *a, struct container const *b)
+{
+    if (a->type == ARRAY)
+        return array_and(a, b);
+    if (b->type == ARRAY)
+        return array_and(b, a);
+    if (a->type == RUN && b->type == RUN)
+        return container_compact(run_and(a, b));
+
+    uint64_t words[CHUNK_WORDS], other[CHUNK_WORDS];
+    container_to_words(a, words);
+    container_to_words(b, other);
+    for (size_t i = 0; i < CHUNK_WORDS; i++)
+        words[i] &= other[i];
+    return container_from_words(words);
+}
+
+static struct container container_or(struct container const *a, struct container const *b)
+{
+    if (a->type == ARRAY && b->type == ARRAY && a->n + b->n <= ARRAY_MAX)
+        return array_or(a, b);
+    if (a->type == RUN && b->type == RUN)
+        return container_compact(run_or(a, b));
+
+    uint64_t words[CHUNK_WORDS];
+    container_to_words(a, words);
+    container_or_words(b, words);
+    return container_from_words(words);
+}
+
+// MARK: Conversion
+static inline size_t no_chunks(size_t len)
+{
+    return (len + CHUNK_BITS - 1) / CHUNK_BITS;
+}
+
+// The number of words of v in chunk key.
+static inline size_t chunk_words(struct bv const *v, size_t key)
+{
+    size_t no_words = (v->len + 63) / 64;
+    size_t left = no_words - key * CHUNK_WORDS;
+    return left < CHUNK_WORDS ? left : CHUNK_WORDS;
+}
+
+struct bv_roaring *bv_roaring_from_bv(struct bv const *v)
+{
+    struct bv_roaring *r = roaring_new(v->len);
+    uint64_t words[CHUNK_WORDS];
+    for (size_t key = 0; key < no_chunks(v->len); key++)
+    {
+        size_t n = chunk_words(v, key);
+        memcpy(words, v->data + key * CHUNK_WORDS, n * sizeof *words);
+        memset(words + n, 0, (CHUNK_WORDS - n) * sizeof *words);
+        if (key == no_chunks(v->len) - 1 && v->len % 64)
+        {
+            words[n - 1] &= ((uint64_t)1 << (v->len % 64)) - 1;
+        }
+        roaring_push(r, (uint32_t)key, container_from_words(words));
+    }
+    return r;
+}
+
+struct bv_roaring *bv_roaring_from_sorted(size_t len, size_t n, size_t const pos[n])
+{
+    struct bv_roaring *r = roaring_new(len);
+    uint64_t words[CHUNK_WORDS];
+    for (size_t i = 0; i < n;)
+    {
+        assert(pos[i] < len && (i == 0 || pos[i - 1] < pos[i]));
+        size_t key = pos[i] / CHUNK_BITS;
+        memset(words, 0, sizeof words);
+        for (; i < n && pos[i] / CHUNK_BITS == key; i++)
+        {
+            set_bit(words, (unsigned)(pos[i] % CHUNK_BITS));
+        }
+        roaring_push(r, (uint32_t)key, container_from_words(words));
+    }
+    return r;
+}
+
+struct bv *bv_roaring_to_bv(struct bv_roaring const *r)
+{
+    struct bv *v = bv_new(r->len);
+    return bv_or_assign_roaring(v, r);
+}
+
+void bv_roaring_free(struct bv_roaring *r)
+{
+    for (size_t i = 0; i < r->n; i++)
+    {
+        free(r->cs[i].values);
+    }
+    free(r->keys);
+    free(r->cs);
+    free(r);
+}
+
+// MARK: Queries
+size_t bv_roaring_len(struct bv_roaring const *r)
+{
+    return r->len;
+}
+
+size_t bv_roaring_bytes(struct bv_roaring const *r)
+{
+    size_t bytes = sizeof *r + r->n * (sizeof *r->keys + sizeof *r->cs);
+    for (size_t i = 0; i < r->n; i++)
+    {
+        bytes += container_bytes(&r->cs[i]);
+    }
+    return bytes;
+}
+
+size_t bv_roaring_count(struct bv_roaring const *r)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < r->n; i++)
+    {
+        count += r->cs[i].card;
+    }
+    return count;
+}
+
+// Index of the container for chunk key, or r->n if there is none.
+static size_t find_key(struct bv_roaring const *r, size_t key)
+{
+    size_t lo = 0, hi = r->n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < r->n && r->keys[lo] == key) ? lo : r->n;
+}
+
+bool bv_roaring_get(struct bv_roaring const *r, size_t i)
+{
+    assert(i < r->len);
+    size_t c = find_key(r, i / CHUNK_BITS);
+    return c < r->n && container_get(&r->cs[c], (uint16_t)(i % CHUNK_BITS));
+}
+
+// MARK: Operations
+struct bv_roaring *bv_roaring_and(struct bv_roaring const *r, struct bv_roaring const *s)
+{
+    assert(r->len == s->len);
+    struct bv_roaring *res = roaring_new(r->len);
+    for (size_t i = 0, j = 0; i < r->n && j < s->n;)
+    {
+        if (r->keys[i] < s->keys[j])
+            i++;
+        else if (r->keys[i] > s->keys[j])
+            j++;
+        else
+        {
+            roaring_push(res, r->keys[i], container_and(&r->cs[i], &s->cs[j]));
+            i++, j++;
+        }
+    }
+    return res;
+}
+
+struct bv_roaring *bv_roaring_or(struct bv_roaring const *r, struct bv_roaring const *s)
+{
+    assert(r->len == s->len);
+    struct bv_roaring *res = roaring_new(r->len);
+    size_t i = 0, j = 0;
+    while (i < r->n || j < s->n)
+    {
+        if (j == s->n || (i < r->n && r->keys[i] < s->keys[j]))
+        {
+            roaring_push(res, r->keys[i], container_copy(&r->cs[i]));
+            i++;
+        }
+        else if (i == r->n || r->keys[i] > s->keys[j])
+        {
+            roaring_push(res, s->keys[j], container_copy(&s->cs[j]));
+            j++;
+        }
+        else
+        {
+            roaring_push(res, r->keys[i], container_or(&r->cs[i], &s->cs[j]));
+            i++, j++;
+        }
+    }
+    return res;
+}
+
+struct bv_roaring *bv_roaring_and_bv(struct bv_roaring const *r, struct bv const *v)
+{
+    assert(r->len == v->len);
+    struct bv_roaring *res = roaring_new(r->len);
+    uint64_t words[CHUNK_WORDS];
+    for (size_t i = 0; i < r->n; i++)
+    {
+        struct container const *c = &r->cs[i];
+        size_t base = (size_t)r->keys[i] * CHUNK_BITS;
+        if (c->type == ARRAY)
+        {
+            // Sparse, so just look up the bits.
+            struct container a = {.type = ARRAY, .n = 0};
+            a.values = checked_malloc(c->n * sizeof *a.values);
+            for (size_t k = 0; k < c->n; k++)
+                if (bv_get(v, base + c->values[k]))
+                    a.values[a.n++] = c->values[k];
+            a.card = a.n;
+            roaring_push(res, r->keys[i], a);
+        }
+        else
+        {
+            size_t n = chunk_words(v, r->keys[i]);
+            uint64_t const *data = v->data + r->keys[i] * CHUNK_WORDS;
+            container_to_words(c, words);
+            for (size_t k = 0; k < n; k++)
+                words[k] &= data[k];
+            roaring_push(res, r->keys[i], container_from_words(words));
+        }
+    }
+    return res;
+}
+
+struct bv *bv_or_assign_roaring(struct bv *v, struct bv_roaring const *r)
+{
+    assert(v->len == r->len);
+    for (size_t i = 0; i < r->n; i++)
+    {
+        // Containers never have bits beyond the vector, so we can treat the
+        // vector's words as the container's bitmap, even in the last chunk
+        // where there are fewer words (we won't touch the ones that are
+        // missing).
+        struct container const *c = &r->cs[i];
+        uint64_t *data = v->data + (size_t)r->keys[i] * CHUNK_WORDS;
+        if (c->type == BITMAP)
+        {
+            size_t n = chunk_words(v, r->keys[i]);
+            for (size_t k = 0; k < n; k++)
+                data[k] |= c->words[k];
+        }
+        else
+        {
+            container_or_words(c, data);
+        }
+    }
+    return v;
+}
+
+struct bv *bv_and_assign_roaring(struct bv *v, struct bv_roaring const *r)
+{
+    assert(v->len == r->len);
+    uint64_t words[CHUNK_WORDS];
+    size_t i = 0;
+    for (size_t key = 0; key < no_chunks(v->len); key++)
+    {
+        uint64_t *data = v->data + key * CHUNK_WORDS;
+        size_t n = chunk_words(v, key);
+        if (i < r->n && r->keys[i] == key)
+        {
+            struct container const *c = &r->cs[i++];
+            uint64_t const *mask = c->words;
+            if (c->type != BITMAP)
+            {
+                container_to_words(c, words);
+                mask = words;
+            }
+            for (size_t k = 0; k < n; k++)
+                data[k] &= mask[k];
+        }
+        else
+        {
+            memset(data, 0, n * sizeof *data); // no container, no set bits
+        }
+    }
+    return v;
+}
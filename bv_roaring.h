@@ -0,0 +1,43 @@
+#ifndef BV_ROARING_H
+#define BV_ROARING_H
+
+// Compressed bit vectors in the style of Roaring bitmaps (Chambi, Lemire,
+// Kaser and Godin, 2016).
+//
+// The bits are split into chunks of 2^16, and we only store the chunks that
+// have set bits. Each chunk is stored in whichever container is smallest:
+//
+//  - an array of the (16-bit) positions of the set bits, for sparse chunks;
+//  - a plain bitmap of 1024 words, for dense chunks;
+//  - a list of runs of set bits, for chunks that are mostly long runs.
+//
+// The operations work directly on the containers, picking the algorithm
+// from the container types, and only the parts that need it are expanded to
+// bitmaps. The vectors are immutable; operations return new vectors.
+
+#include "bv.h"
+
+struct bv_roaring;
+
+struct bv_roaring *bv_roaring_from_bv(struct bv const *v);
+// From a sorted list of n distinct positions, all less than len.
+struct bv_roaring *bv_roaring_from_sorted(size_t len, size_t n, size_t const pos[n]);
+struct bv *bv_roaring_to_bv(struct bv_roaring const *r);
+void bv_roaring_free(struct bv_roaring *r);
+
+size_t bv_roaring_len(struct bv_roaring const *r);   // length in bits
+size_t bv_roaring_bytes(struct bv_roaring const *r); // memory used
+size_t bv_roaring_count(struct bv_roaring const *r); // number of set bits
+bool bv_roaring_get(struct bv_roaring const *r, size_t i);
+
+// These return new (compressed) vectors.
+struct bv_roaring *bv_roaring_and(struct bv_roaring const *r, struct bv_roaring const *s); // r & s
+struct bv_roaring *bv_roaring_or(struct bv_roaring const *r, struct bv_roaring const *s);  // r | s
+struct bv_roaring *bv_roaring_and_bv(struct bv_roaring const *r, struct bv const *v);      // r & v
+
+// Mixed dense/compressed operations that update the dense vector and
+// return it, like bv_or_assign() and bv_and_assign().
+struct bv *bv_or_assign_roaring(struct bv *v, struct bv_roaring const *r);  // v |= r
+struct bv *bv_and_assign_roaring(struct bv *v, struct bv_roaring const *r); // v &= r
+
+#endif // BV_ROARING_H
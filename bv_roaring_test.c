@@ -0,0 +1,168 @@
+#include "bv_roaring.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// A vector that mixes the cases the containers are made for: chunks that
+// are empty, sparse, dense, and made of long runs.
+static struct bv *mixed_vector(size_t n)
+{
+    struct bv *v = bv_new(n);
+    size_t chunk = 65536;
+    for (size_t start = 0; start < n; start += chunk)
+    {
+        size_t end = start + chunk < n ? start + chunk : n;
+        switch (rng() % 4)
+        {
+        case 0: // empty
+            break;
+        case 1: // sparse
+            for (size_t i = start; i < end; i++)
+                bv_set(v, i, rng() % 200 == 0);
+            break;
+        case 2: // dense
+            for (size_t i = start; i < end; i++)
+                bv_set(v, i, rng() % 2);
+            break;
+        case 3: // runs
+        {
+            bool bit = rng() % 2;
+            for (size_t i = start; i < end; i++)
+            {
+                if (rng() % 1000 == 0)
+                    bit = !bit;
+                bv_set(v, i, bit);
+            }
+            break;
+        }
+        }
+    }
+    return v;
+}
+
+// Only used in asserts, so unused under NDEBUG.
+__attribute__((unused)) static size_t count(struct bv const *v)
+{
+    size_t c = 0;
+    for (size_t i = 0; i < v->len; i++)
+        c += bv_get(v, i);
+    return c;
+}
+
+static void test_conversion(void)
+{
+    size_t sizes[] = {0, 1, 100, 65536, 65537, 1000000};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        struct bv *v = mixed_vector(sizes[s]);
+        struct bv_roaring *r = bv_roaring_from_bv(v);
+        assert(bv_roaring_len(r) == v->len);
+        assert(bv_roaring_count(r) == count(v));
+        for (size_t i = 0; i < v->len; i++)
+            assert(bv_roaring_get(r, i) == bv_get(v, i));
+
+        struct bv *w = bv_roaring_to_bv(r);
+        assert(bv_eq(v, w));
+
+        free(w);
+        free(v);
+        bv_roaring_free(r);
+    }
+}
+
+static void test_from_sorted(void)
+{
+    size_t n = 500000;
+    struct bv *v = mixed_vector(n);
+    size_t *pos = malloc(n * sizeof *pos), k = 0;
+    assert(pos);
+    for (size_t i = 0; i < n; i++)
+        if (bv_get(v, i))
+            pos[k++] = i;
+    struct bv_roaring *r = bv_roaring_from_sorted(n, k, pos);
+    struct bv *w = bv_roaring_to_bv(r);
+    assert(bv_eq(v, w));
+    free(w);
+    free(pos);
+    free(v);
+    bv_roaring_free(r);
+}
+
+static void test_operations(void)
+{
+    for (int rep = 0; rep < 10; rep++)
+    {
+        size_t n = 700000 + rng() % 1000;
+        struct bv *v = mixed_vector(n), *w = mixed_vector(n);
+        struct bv_roaring *r = bv_roaring_from_bv(v), *s = bv_roaring_from_bv(w);
+        struct bv *and = bv_and(v, w), *or = bv_or(v, w);
+
+        struct bv_roaring *x = bv_roaring_and(r, s);
+        struct bv *y = bv_roaring_to_bv(x);
+        assert(bv_eq(y, and));
+        assert(bv_roaring_count(x) == count(and));
+        bv_roaring_free(x);
+        free(y);
+
+        x = bv_roaring_or(r, s);
+        y = bv_roaring_to_bv(x);
+        assert(bv_eq(y, or));
+        assert(bv_roaring_count(x) == count(or));
+        bv_roaring_free(x);
+        free(y);
+
+        // Mixed dense and compressed
+        x = bv_roaring_and_bv(r, w);
+        y = bv_roaring_to_bv(x);
+        assert(bv_eq(y, and));
+        bv_roaring_free(x);
+        free(y);
+
+        y = bv_copy(w);
+        assert(bv_eq(bv_and_assign_roaring(y, r), and));
+        free(y);
+
+        y = bv_copy(w);
+        assert(bv_eq(bv_or_assign_roaring(y, r), or));
+        free(y);
+
+        free(and);
+        free(or);
+        free(v);
+        free(w);
+        bv_roaring_free(r);
+        bv_roaring_free(s);
+    }
+}
+
+static void test_compression(void)
+{
+    // Very sparse and long runs should both compress by far more than 10x.
+    size_t n = 100000000;
+    struct bv *v = bv_new(n);
+    for (size_t i = 0; i < n; i += 5000)
+        bv_set(v, i, 1);
+    struct bv_roaring *r = bv_roaring_from_bv(v);
+    assert(bv_roaring_bytes(r) * 10 < n / 8);
+    bv_roaring_free(r);
+
+    bv_zero(v);
+    for (size_t i = 0; i < n; i++)
+        bv_set(v, i, (i / 1000000) % 2);
+    r = bv_roaring_from_bv(v);
+    assert(bv_roaring_bytes(r) * 100 < n / 8);
+    bv_roaring_free(r);
+    free(v);
+}
+
+int main(void)
+{
+    test_conversion();
+    test_from_sorted();
+    test_operations();
+    test_compression();
+
+    return 0;
+}
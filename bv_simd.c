@@ -0,0 +1,483 @@
+#include "bv.h"
+#include "bv_kernels.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BV_X86 1
+#include <immintrin.h>
+#endif
+
+// MARK: Scalar kernels
+// These are the fallback for CPUs without SIMD support (and for other
+// architectures), and the reference the SIMD versions are tested against.
+
+static void or_scalar(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = a[i] | b[i];
+}
+
+static void and_scalar(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = a[i] & b[i];
+}
+
+static void not_scalar(uint64_t *dst, uint64_t const *a, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = ~a[i];
+}
+
+static void fill_scalar(uint64_t *dst, uint64_t w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = w;
+}
+
+static void copy_scalar(uint64_t *dst, uint64_t const *a, size_t n)
+{
+    memcpy(dst, a, n * sizeof *dst);
+}
+
+static bool eq_scalar(uint64_t const *a, uint64_t const *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+static void xor_scalar(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = a[i] ^ b[i];
+}
+
+static void andnot_scalar(uint64_t *dst, uint64_t const *a, uint64_t const *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = a[i] & ~b[i];
+}
+
+static size_t count_scalar(uint64_t const *a, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+        count += (size_t)__builtin_popcountll(a[i]);
+    return count;
+}
+
+static void pack_scalar(uint64_t *dst, unsigned char const *src, size_t n, unsigned char zero)
+{
+    for (size_t i = 0; i < n; i += 64)
+    {
+        uint64_t w = 0;
+        for (size_t j = 0; j < 64 && i + j < n; j++)
+            w |= (uint64_t)(src[i + j] != zero) << j;
+        dst[i / 64] = w;
+    }
+}
+
+static void unpack_scalar(unsigned char *dst, uint64_t const *src, size_t n,
+                          unsigned char zero, unsigned char one)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = ((src[i / 64] >> (i % 64)) & 1) ? one : zero;
+}
+
+static const struct bv_kernels scalar_kernels = {
+    or_scalar, and_scalar, not_scalar, fill_scalar, copy_scalar, eq_scalar,
+    xor_scalar, andnot_scalar, count_scalar, pack_scalar, unpack_scalar};
+
+// MARK: x86 kernels
+#ifdef BV_X86
+
+// Packing compares bytes with a vector compare and collects the results with
+// movemask (or, on AVX-512, gets the bits directly as a mask register).
+// Unpacking spreads each byte of bits over eight bytes, picks out one bit
+// per byte with a mask and compares to get 0x00 or 0xff, and then blends
+// the zero and one characters. The kernels handle whole words and leave
+// the last partial word to the scalar code.
+
+__attribute__((target("sse2")))
+static void pack_sse2(uint64_t *dst, unsigned char const *src, size_t n, unsigned char zero)
+{
+    __m128i z = _mm_set1_epi8((char)zero);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        uint64_t w = 0;
+        for (size_t j = 0; j < 64; j += 16)
+        {
+            __m128i x = _mm_loadu_si128((__m128i const *)(src + i + j));
+            uint64_t zeros = (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, z));
+            w |= (~zeros & 0xffff) << j;
+        }
+        dst[i / 64] = w;
+    }
+    pack_scalar(dst + i / 64, src + i, n - i, zero);
+}
+
+__attribute__((target("sse2")))
+static void unpack_sse2(unsigned char *dst, uint64_t const *src, size_t n,
+                        unsigned char zero, unsigned char one)
+{
+    __m128i bit = _mm_set1_epi64x((long long)0x8040201008040201);
+    __m128i z = _mm_set1_epi8((char)zero), d = _mm_set1_epi8((char)(zero ^ one));
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        uint64_t w = src[i / 64];
+        for (size_t j = 0; j < 64; j += 16, w >>= 16)
+        {
+            // Two bytes of bits, each repeated eight times.
+            __m128i x = _mm_cvtsi32_si128((int)(w & 0xffff));
+            x = _mm_unpacklo_epi8(x, x);
+            x = _mm_unpacklo_epi16(x, x);
+            x = _mm_unpacklo_epi32(x, x);
+            __m128i set = _mm_cmpeq_epi8(_mm_and_si128(x, bit), bit);
+            _mm_storeu_si128((__m128i *)(dst + i + j), _mm_xor_si128(z, _mm_and_si128(set, d)));
+        }
+    }
+    unpack_scalar(dst + i, src + i / 64, n - i, zero, one);
+}
+
+__attribute__((target("avx2")))
+static void pack_avx2(uint64_t *dst, unsigned char const *src, size_t n, unsigned char zero)
+{
+    __m256i z = _mm256_set1_epi8((char)zero);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        __m256i lo = _mm256_loadu_si256((__m256i const *)(src + i));
+        __m256i hi = _mm256_loadu_si256((__m256i const *)(src + i + 32));
+        uint32_t zeros_lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, z));
+        uint32_t zeros_hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, z));
+        dst[i / 64] = ~((uint64_t)zeros_hi << 32 | zeros_lo);
+    }
+    pack_scalar(dst + i / 64, src + i, n - i, zero);
+}
+
+__attribute__((target("avx2")))
+static void unpack_avx2(unsigned char *dst, uint64_t const *src, size_t n,
+                        unsigned char zero, unsigned char one)
+{
+    __m256i bit = _mm256_set1_epi64x((long long)0x8040201008040201);
+    // Byte k of the 32 bits goes to bytes 8k, ..., 8k + 7.
+    __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                      2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    __m256i z = _mm256_set1_epi8((char)zero), d = _mm256_set1_epi8((char)(zero ^ one));
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        uint64_t w = src[i / 64];
+        for (size_t j = 0; j < 64; j += 32, w >>= 32)
+        {
+            __m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(uint32_t)w), spread);
+            __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(x, bit), bit);
+            _mm256_storeu_si256((__m256i *)(dst + i + j),
+                                _mm256_xor_si256(z, _mm256_and_si256(set, d)));
+        }
+    }
+    unpack_scalar(dst + i, src + i / 64, n - i, zero, one);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void pack_avx512(uint64_t *dst, unsigned char const *src, size_t n, unsigned char zero)
+{
+    __m512i z = _mm512_set1_epi8((char)zero);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+        dst[i / 64] = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(src + i), z);
+    pack_scalar(dst + i / 64, src + i, n - i, zero);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void unpack_avx512(unsigned char *dst, uint64_t const *src, size_t n,
+                          unsigned char zero, unsigned char one)
+{
+    __m512i z = _mm512_set1_epi8((char)zero), o = _mm512_set1_epi8((char)one);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+        _mm512_storeu_si512(dst + i, _mm512_mask_blend_epi8(src[i / 64], z, o));
+    unpack_scalar(dst + i, src + i / 64, n - i, zero, one);
+}
+
+// Counting with AVX2 uses the Harley-Seal scheme (Mula, Kurz and Lemire,
+// "Faster population counts using AVX2 instructions"): a tree of carry-save
+// adders sums 16 vectors into vectors of ones, twos, fours, eights and
+// sixteens, so we only popcount one vector in 16. That popcount looks up
+// the nibbles in a 16-entry table with pshufb and sums the bytes with sad.
+// SSE2 has neither trick to spare, and there the popcnt instruction on
+// each word is as fast, so it uses the scalar kernel.
+
+__attribute__((target("avx2")))
+static inline __m256i popcount_avx2(__m256i v)
+{
+    __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                     0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+// clang-format off
+#define CSA(H, L, A, B, C)                                                       \
+    do                                                                           \
+    {                                                                            \
+        __m256i u_ = _mm256_xor_si256((A), (B));                                 \
+        (H) = _mm256_or_si256(_mm256_and_si256((A), (B)), _mm256_and_si256(u_, (C))); \
+        (L) = _mm256_xor_si256(u_, (C));                                         \
+    } while (0)
+// clang-format on
+
+__attribute__((target("avx2")))
+static size_t count_avx2(uint64_t const *a, size_t n)
+{
+    __m256i const *v = (__m256i const *)a;
+    size_t no_vecs = n / 4, i = 0;
+    __m256i total = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256(), twos = ones, fours = ones, eights = ones;
+    __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b, sixteens;
+    for (; i + 16 <= no_vecs; i += 16)
+    {
+        CSA(twos_a, ones, ones, _mm256_loadu_si256(v + i + 0), _mm256_loadu_si256(v + i + 1));
+        CSA(twos_b, ones, ones, _mm256_loadu_si256(v + i + 2), _mm256_loadu_si256(v + i + 3));
+        CSA(fours_a, twos, twos, twos_a, twos_b);
+        CSA(twos_a, ones, ones, _mm256_loadu_si256(v + i + 4), _mm256_loadu_si256(v + i + 5));
+        CSA(twos_b, ones, ones, _mm256_loadu_si256(v + i + 6), _mm256_loadu_si256(v + i + 7));
+        CSA(fours_b, twos, twos, twos_a, twos_b);
+        CSA(eights_a, fours, fours, fours_a, fours_b);
+        CSA(twos_a, ones, ones, _mm256_loadu_si256(v + i + 8), _mm256_loadu_si256(v + i + 9));
+        CSA(twos_b, ones, ones, _mm256_loadu_si256(v + i + 10), _mm256_loadu_si256(v + i + 11));
+        CSA(fours_a, twos, twos, twos_a, twos_b);
+        CSA(twos_a, ones, ones, _mm256_loadu_si256(v + i + 12), _mm256_loadu_si256(v + i + 13));
+        CSA(twos_b, ones, ones, _mm256_loadu_si256(v + i + 14), _mm256_loadu_si256(v + i + 15));
+        CSA(fours_b, twos, twos, twos_a, twos_b);
+        CSA(eights_b, fours, fours, fours_a, fours_b);
+        CSA(sixteens, eights, eights, eights_a, eights_b);
+        total = _mm256_add_epi64(total, popcount_avx2(sixteens));
+    }
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_avx2(twos), 1));
+    total = _mm256_add_epi64(total, popcount_avx2(ones));
+    for (; i < no_vecs; i++)
+        total = _mm256_add_epi64(total, popcount_avx2(_mm256_loadu_si256(v + i)));
+
+    size_t count = (size_t)_mm256_extract_epi64(total, 0) + (size_t)_mm256_extract_epi64(total, 1) +
+                   (size_t)_mm256_extract_epi64(total, 2) + (size_t)_mm256_extract_epi64(total, 3);
+    return count + count_scalar(a + 4 * i, n - 4 * i);
+}
+
+// With VPOPCNTDQ there is a popcount per 64-bit lane, and that is all we
+// need. The AVX-512 table uses it when the CPU has it and the AVX2 kernel
+// otherwise.
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static size_t count_avx512(uint64_t const *a, size_t n)
+{
+    __m512i acc0 = _mm512_setzero_si512(), acc1 = acc0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i + 8)));
+    }
+    size_t count = (size_t)_mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+    return count + count_scalar(a + i, n - i);
+}
+
+// The kernels for the different instruction sets only differ in the vector
+// type and the intrinsics, so we generate them from the same template. Each
+// handles the whole vectors with SIMD and leaves the tail to the scalar code.
+// Loads and stores are unaligned, since calloc only guarantees 16 bytes, but
+// on modern CPUs that costs nothing when the address happens to be aligned.
+
+// clang-format off
+#define SIMD_KERNELS(ISA, TARGET, VEC, LOAD, STORE, OR, AND, XOR, ANDNOT,     \
+                     SET1, ALL_ZERO, COUNT)                                      \
+    __attribute__((target(TARGET)))                                              \
+    static void or_##ISA(uint64_t *dst, uint64_t const *a, uint64_t const *b,   \
+                         size_t n)                                               \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), OR(LOAD((VEC const *)(a + i)),               \
+                                       LOAD((VEC const *)(b + i))));             \
+        or_scalar(dst + i, a + i, b + i, n - i);                                 \
+    }                                                                            \
+    __attribute__((target(TARGET)))                                              \
+    static void and_##ISA(uint64_t *dst, uint64_t const *a, uint64_t const *b,  \
+                          size_t n)                                              \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), AND(LOAD((VEC const *)(a + i)),              \
+                                        LOAD((VEC const *)(b + i))));            \
+        and_scalar(dst + i, a + i, b + i, n - i);                                \
+    }                                                                            \
+    __attribute__((target(TARGET)))                                              \
+    static void xor_##ISA(uint64_t *dst, uint64_t const *a, uint64_t const *b,  \
+                          size_t n)                                              \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), XOR(LOAD((VEC const *)(a + i)),              \
+                                        LOAD((VEC const *)(b + i))));            \
+        xor_scalar(dst + i, a + i, b + i, n - i);                                \
+    }                                                                            \
+    /* The intrinsics compute ~x & y, so the operands go in swapped. */        \
+    __attribute__((target(TARGET)))                                              \
+    static void andnot_##ISA(uint64_t *dst, uint64_t const *a,                   \
+                             uint64_t const *b, size_t n)                        \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), ANDNOT(LOAD((VEC const *)(b + i)),           \
+                                           LOAD((VEC const *)(a + i))));         \
+        andnot_scalar(dst + i, a + i, b + i, n - i);                             \
+    }                                                                            \
+    __attribute__((target(TARGET)))                                              \
+    static void not_##ISA(uint64_t *dst, uint64_t const *a, size_t n)            \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        VEC ones = SET1(-1);                                                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), XOR(LOAD((VEC const *)(a + i)), ones));      \
+        not_scalar(dst + i, a + i, n - i);                                       \
+    }                                                                            \
+    __attribute__((target(TARGET)))                                              \
+    static void fill_##ISA(uint64_t *dst, uint64_t w, size_t n)                  \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        VEC x = SET1((long long)w);                                              \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), x);                                          \
+        fill_scalar(dst + i, w, n - i);                                          \
+    }                                                                            \
+    __attribute__((target(TARGET)))                                              \
+    static void copy_##ISA(uint64_t *dst, uint64_t const *a, size_t n)           \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + step <= n; i += step)                                         \
+            STORE((VEC *)(dst + i), LOAD((VEC const *)(a + i)));                 \
+        copy_scalar(dst + i, a + i, n - i);                                      \
+    }                                                                            \
+    /* Compares four vectors at a time and only branches once per block. */    \
+    __attribute__((target(TARGET)))                                              \
+    static bool eq_##ISA(uint64_t const *a, uint64_t const *b, size_t n)         \
+    {                                                                            \
+        size_t step = sizeof(VEC) / sizeof(uint64_t), i = 0;                     \
+        for (; i + 4 * step <= n; i += 4 * step)                                 \
+        {                                                                        \
+            VEC d0 = XOR(LOAD((VEC const *)(a + i)),                             \
+                         LOAD((VEC const *)(b + i)));                            \
+            VEC d1 = XOR(LOAD((VEC const *)(a + i + step)),                      \
+                         LOAD((VEC const *)(b + i + step)));                     \
+            VEC d2 = XOR(LOAD((VEC const *)(a + i + 2 * step)),                  \
+                         LOAD((VEC const *)(b + i + 2 * step)));                 \
+            VEC d3 = XOR(LOAD((VEC const *)(a + i + 3 * step)),                  \
+                         LOAD((VEC const *)(b + i + 3 * step)));                 \
+            if (!ALL_ZERO(OR(OR(d0, d1), OR(d2, d3))))                           \
+                return false;                                                    \
+        }                                                                        \
+        for (; i + step <= n; i += step)                                         \
+            if (!ALL_ZERO(XOR(LOAD((VEC const *)(a + i)),                        \
+                              LOAD((VEC const *)(b + i)))))                      \
+                return false;                                                    \
+        return eq_scalar(a + i, b + i, n - i);                                   \
+    }                                                                            \
+    static const struct bv_kernels ISA##_kernels = {                             \
+        or_##ISA, and_##ISA, not_##ISA, fill_##ISA, copy_##ISA, eq_##ISA,        \
+        xor_##ISA, andnot_##ISA, COUNT, pack_##ISA, unpack_##ISA};
+// clang-format on
+
+#define SSE2_ALL_ZERO(X) (_mm_movemask_epi8(_mm_cmpeq_epi8((X), _mm_setzero_si128())) == 0xffff)
+#define AVX2_ALL_ZERO(X) _mm256_testz_si256((X), (X))
+#define AVX512_ALL_ZERO(X) (_mm512_test_epi64_mask((X), (X)) == 0)
+
+SIMD_KERNELS(sse2, "sse2", __m128i, _mm_loadu_si128, _mm_storeu_si128,
+             _mm_or_si128, _mm_and_si128, _mm_xor_si128, _mm_andnot_si128,
+             _mm_set1_epi64x, SSE2_ALL_ZERO, count_scalar)
+SIMD_KERNELS(avx2, "avx2", __m256i, _mm256_loadu_si256, _mm256_storeu_si256,
+             _mm256_or_si256, _mm256_and_si256, _mm256_xor_si256, _mm256_andnot_si256,
+             _mm256_set1_epi64x, AVX2_ALL_ZERO, count_avx2)
+SIMD_KERNELS(avx512, "avx512f", __m512i, _mm512_loadu_si512, _mm512_storeu_si512,
+             _mm512_or_si512, _mm512_and_si512, _mm512_xor_si512, _mm512_andnot_si512,
+             _mm512_set1_epi64, AVX512_ALL_ZERO, count_avx2)
+
+#endif // BV_X86
+
+// MARK: Dispatch
+
+// Start out with the scalar kernels, so the library works even before the
+// constructor below has run (or if the compiler doesn't support it).
+struct bv_kernels bv_kernels = {
+    or_scalar, and_scalar, not_scalar, fill_scalar, copy_scalar, eq_scalar,
+    xor_scalar, andnot_scalar, count_scalar, pack_scalar, unpack_scalar};
+
+static enum bv_isa current_isa = BV_ISA_SCALAR;
+
+static enum bv_isa best_supported_isa(void)
+{
+#ifdef BV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return BV_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return BV_ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return BV_ISA_SSE2;
+#endif
+    return BV_ISA_SCALAR;
+}
+
+enum bv_isa bv_isa(void)
+{
+    return current_isa;
+}
+
+enum bv_isa bv_isa_select(enum bv_isa isa)
+{
+    enum bv_isa best = best_supported_isa();
+    if (isa > best)
+        isa = best;
+
+    switch (isa)
+    {
+#ifdef BV_X86
+    case BV_ISA_AVX512:
+        bv_kernels = avx512_kernels;
+        // The byte kernels need AVX-512BW on top of the foundation.
+        if (!__builtin_cpu_supports("avx512bw"))
+        {
+            bv_kernels.pack_bytes = pack_avx2;
+            bv_kernels.unpack_bytes = unpack_avx2;
+        }
+        if (__builtin_cpu_supports("avx512vpopcntdq"))
+            bv_kernels.count_words = count_avx512;
+        break;
+    case BV_ISA_AVX2:
+        bv_kernels = avx2_kernels;
+        break;
+    case BV_ISA_SSE2:
+        bv_kernels = sse2_kernels;
+        break;
+#endif
+    default:
+        bv_kernels = scalar_kernels;
+        isa = BV_ISA_SCALAR;
+        break;
+    }
+    current_isa = isa;
+    return isa;
+}
+
+__attribute__((constructor)) static void bv_kernels_init(void)
+{
+    bv_isa_select(BV_ISA_AVX512);
+}
@@ -0,0 +1,181 @@
+#include "bv_stats.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static const char *names[] = {
+#define BV_STATS_NAME(OP, NAME) #NAME,
+    BV_STATS_OPS(BV_STATS_NAME)
+#undef BV_STATS_NAME
+};
+
+const char *bv_stats_name(enum bv_op op)
+{
+    assert(op < BV_NO_OPS);
+    return names[op];
+}
+
+#ifdef BV_STATS
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A table per thread. Only the thread that owns it writes to it, so a
+// relaxed load and store, plain moves, are enough for the updates; the
+// atomics are there so reading from other threads isn't a data race.
+struct table
+{
+    _Atomic uint64_t calls[BV_NO_OPS], words[BV_NO_OPS],
+        bytes[BV_NO_OPS], ticks[BV_NO_OPS];
+    struct table *next;
+};
+
+// The tables of all threads, including those that have finished; we keep
+// their counts.
+static struct table *tables = NULL;
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct table *local = NULL;
+
+static struct table *local_table(void)
+{
+    if (!local)
+    {
+        local = calloc(1, sizeof *local);
+        assert(local); // We don't handle allocation errors
+        pthread_mutex_lock(&tables_lock);
+        local->next = tables;
+        tables = local;
+        pthread_mutex_unlock(&tables_lock);
+    }
+    return local;
+}
+
+static inline void add(_Atomic uint64_t *counter, uint64_t x)
+{
+    atomic_store_explicit(counter,
+                          atomic_load_explicit(counter, memory_order_relaxed) + x,
+                          memory_order_relaxed);
+}
+
+void bv_stats_record(enum bv_op op, uint64_t words, uint64_t bytes, uint64_t ticks)
+{
+    struct table *t = local_table();
+    add(&t->calls[op], 1);
+    add(&t->words[op], words);
+    add(&t->bytes[op], bytes);
+    add(&t->ticks[op], ticks);
+}
+
+bool bv_stats_enabled(void)
+{
+    return true;
+}
+
+struct bv_stats_counts bv_stats_get(enum bv_op op)
+{
+    assert(op < BV_NO_OPS);
+    struct bv_stats_counts c = {0, 0, 0, 0};
+    pthread_mutex_lock(&tables_lock);
+    for (struct table *t = tables; t; t = t->next)
+    {
+        c.calls += atomic_load_explicit(&t->calls[op], memory_order_relaxed);
+        c.words += atomic_load_explicit(&t->words[op], memory_order_relaxed);
+        c.bytes += atomic_load_explicit(&t->bytes[op], memory_order_relaxed);
+        c.ticks += atomic_load_explicit(&t->ticks[op], memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&tables_lock);
+    return c;
+}
+
+void bv_stats_reset(void)
+{
+    pthread_mutex_lock(&tables_lock);
+    for (struct table *t = tables; t; t = t->next)
+    {
+        for (size_t op = 0; op < BV_NO_OPS; op++)
+        {
+            atomic_store_explicit(&t->calls[op], 0, memory_order_relaxed);
+            atomic_store_explicit(&t->words[op], 0, memory_order_relaxed);
+            atomic_store_explicit(&t->bytes[op], 0, memory_order_relaxed);
+            atomic_store_explicit(&t->ticks[op], 0, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&tables_lock);
+}
+
+#else
+
+bool bv_stats_enabled(void)
+{
+    return false;
+}
+
+struct bv_stats_counts bv_stats_get(enum bv_op op)
+{
+    assert(op < BV_NO_OPS);
+    (void)op;
+    return (struct bv_stats_counts){0, 0, 0, 0};
+}
+
+void bv_stats_reset(void)
+{
+}
+
+#endif // BV_STATS
+
+// MARK: Output
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TICKS "rdtsc"
+#else
+#define TICKS "ns"
+#endif
+
+void bv_stats_dump(FILE *f, bool json)
+{
+    if (json)
+    {
+        fprintf(f, "{\"enabled\": %s, \"ticks\": \"%s\", \"operations\": [",
+                bv_stats_enabled() ? "true" : "false", TICKS);
+    }
+    else if (!bv_stats_enabled())
+    {
+        fprintf(f, "No operation counts; build with -DBV_STATS=ON for them.\n");
+        return;
+    }
+    else
+    {
+        fprintf(f, "%-22s %12s %14s %14s %16s %10s %10s\n", "operation",
+                "calls", "words", "bytes", "ticks (" TICKS ")", "ticks/call", "ticks/word");
+    }
+
+    const char *sep = "";
+    for (size_t op = 0; op < BV_NO_OPS; op++)
+    {
+        struct bv_stats_counts c = bv_stats_get(op);
+        if (c.calls == 0)
+            continue;
+        if (json)
+        {
+            fprintf(f,
+                    "%s\n  {\"op\": \"%s\", \"calls\": %llu, \"words\": %llu, "
+                    "\"bytes\": %llu, \"ticks\": %llu}",
+                    sep, names[op], (unsigned long long)c.calls,
+                    (unsigned long long)c.words, (unsigned long long)c.bytes,
+                    (unsigned long long)c.ticks);
+            sep = ",";
+        }
+        else
+        {
+            fprintf(f, "%-22s %12llu %14llu %14llu %16llu %10.1f", names[op],
+                    (unsigned long long)c.calls, (unsigned long long)c.words,
+                    (unsigned long long)c.bytes, (unsigned long long)c.ticks,
+                    (double)c.ticks / (double)c.calls);
+            if (c.words)
+                fprintf(f, " %10.2f\n", (double)c.ticks / (double)c.words);
+            else
+                fprintf(f, " %10s\n", "-");
+        }
+    }
+    if (json)
+        fprintf(f, "%s]}\n", *sep ? "\n" : "");
+}
@@ -0,0 +1,123 @@
+#ifndef BV_STATS_H
+#define BV_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Counters for the operations in bv.c: how often each one is called, how
+// many words it works on, how many bytes it allocates, and how long it
+// takes, in time-stamp counter ticks on x86 (roughly cycles) and in
+// nanoseconds elsewhere.
+//
+// The counters are only there when the library is built with BV_STATS
+// defined (cmake -DBV_STATS=ON). Otherwise the hooks in bv.c expand to
+// nothing, so they cost nothing, and the functions here see only zeros.
+//
+// Each thread counts in a table of its own, so threads don't contend for
+// the counters, and reading them sums the tables. Operations that call
+// other operations, like bv_or() calling bv_alloc() and bv_or_into(),
+// count those as well, and their ticks include the time spent in them.
+
+// clang-format off
+#define BV_STATS_OPS(X)                                                   \
+    X(ALLOC, bv_alloc) X(INIT, bv_init) X(NEW, bv_new)                    \
+    X(NEW_FROM_STRING, bv_new_from_string)                                \
+    X(COPY, bv_copy) X(COPY_INTO, bv_copy_into)                           \
+    X(ARENA_NEW, bv_arena_new) X(ARENA_ALLOC, bv_arena_alloc)             \
+    X(ARENA_RESET, bv_arena_reset) X(ARENA_FREE, bv_arena_free)           \
+    X(ZERO, bv_zero) X(ONE, bv_one) X(NEG, bv_neg)                        \
+    X(SHIFT_UP, bv_shift_up) X(SHIFT_DOWN, bv_shift_down)                 \
+    X(SHIFT_UP_OR_ASSIGN, bv_shift_up_or_assign)                          \
+    X(OR_ASSIGN, bv_or_assign) X(AND_ASSIGN, bv_and_assign)               \
+    X(OR, bv_or) X(AND, bv_and) X(OR_INTO, bv_or_into)                    \
+    X(AND_INTO, bv_and_into) X(EQ, bv_eq)                                 \
+    X(SET_RANGE, bv_set_range) X(CLEAR_RANGE, bv_clear_range)             \
+    X(FLIP_RANGE, bv_flip_range) X(COUNT_RANGE, bv_count_range)           \
+    X(COUNT, bv_count) X(FIND_FIRST, bv_find_first)                       \
+    X(FIND_NEXT, bv_find_next) X(FIND_FIRST_ZERO, bv_find_first_zero)     \
+    X(FIND_NEXT_ZERO, bv_find_next_zero) X(POSITIONS, bv_positions)       \
+    X(COPY_BITS, bv_copy_bits) X(PRINT, bv_print)                         \
+    X(PACK_BYTES, bv_pack_bytes) X(PACK_TEXT, bv_pack_text)               \
+    X(UNPACK_BYTES, bv_unpack_bytes) X(FORMAT, bv_format)                 \
+    X(FORMAT_HEX, bv_format_hex)
+// clang-format on
+
+enum bv_op
+{
+#define BV_STATS_ENUM(OP, NAME) BV_OP_##OP,
+    BV_STATS_OPS(BV_STATS_ENUM)
+#undef BV_STATS_ENUM
+        BV_NO_OPS
+};
+
+struct bv_stats_counts
+{
+    uint64_t calls, words, bytes, ticks;
+};
+
+bool bv_stats_enabled(void);             // built with BV_STATS?
+const char *bv_stats_name(enum bv_op op); // "bv_or_assign" and so on
+// The counts for op, summed over all threads.
+struct bv_stats_counts bv_stats_get(enum bv_op op);
+// Zero the counters. Counts from threads running operations meanwhile
+// may or may not survive, so call it while the others are quiet.
+void bv_stats_reset(void);
+// Write the operations called so far, as a table or as JSON.
+void bv_stats_dump(FILE *f, bool json);
+
+// MARK: Hooks
+// For bv.c. BV_STATS_SCOPE() goes first in a function, and records the
+// call, with the words given and those added with BV_STATS_WORDS() and the
+// bytes added with BV_STATS_BYTES(), when the function returns.
+#ifdef BV_STATS
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+static inline uint64_t bv_stats_ticks(void)
+{
+    return __rdtsc();
+}
+#else
+#include <time.h>
+static inline uint64_t bv_stats_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+struct bv_stats_scope
+{
+    enum bv_op op;
+    uint64_t words, bytes, start;
+};
+
+void bv_stats_record(enum bv_op op, uint64_t words, uint64_t bytes, uint64_t ticks);
+
+static inline void bv_stats_scope_end(struct bv_stats_scope *s)
+{
+    bv_stats_record(s->op, s->words, s->bytes, bv_stats_ticks() - s->start);
+}
+
+// clang-format off
+#define BV_STATS_SCOPE(OP, WORDS)                                            \
+    struct bv_stats_scope bv_stats_scope_                                    \
+        __attribute__((cleanup(bv_stats_scope_end))) =                       \
+            {BV_OP_##OP, (WORDS), 0, bv_stats_ticks()}
+#define BV_STATS_WORDS(N) (bv_stats_scope_.words += (N))
+#define BV_STATS_BYTES(N) (bv_stats_scope_.bytes += (N))
+// clang-format on
+
+#else
+
+// Nothing is evaluated, but sizeof still uses the arguments, so variables
+// that only the hooks read don't give us warnings.
+#define BV_STATS_SCOPE(OP, WORDS) ((void)sizeof(WORDS))
+#define BV_STATS_WORDS(N) ((void)sizeof(N))
+#define BV_STATS_BYTES(N) ((void)sizeof(N))
+
+#endif // BV_STATS
+
+#endif // BV_STATS_H
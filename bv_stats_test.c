@@ -0,0 +1,150 @@
+#include "bv.h"
+#include "bv_stats.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_THREADS 4
+#define CALLS_PER_THREAD 1000
+
+// Without BV_STATS there is nothing to count, but the functions still work.
+static void test_disabled(void)
+{
+    struct bv *v = bv_new(1000);
+    bv_or_assign(v, v);
+    for (size_t op = 0; op < BV_NO_OPS; op++)
+    {
+        struct bv_stats_counts c = bv_stats_get(op);
+        assert(c.calls == 0 && c.words == 0 && c.bytes == 0 && c.ticks == 0);
+    }
+    bv_stats_reset();
+    free(v);
+}
+
+static void test_counts(void)
+{
+    bv_stats_reset();
+    struct bv *v = bv_new(1000); // 16 words
+    struct bv *w = bv_new_from_string("0110");
+    struct bv_stats_counts c = bv_stats_get(BV_OP_NEW);
+    assert(c.calls == 1 && c.words == 16 && c.bytes == 0);
+    // bv_alloc() is counted for both, and is where the bytes are.
+    c = bv_stats_get(BV_OP_ALLOC);
+    assert(c.calls == 2 && c.words == 17 && c.bytes == bv_size(1000) + bv_size(4));
+
+    for (int i = 0; i < 3; i++)
+    {
+        bv_or_assign(v, v);
+    }
+    c = bv_stats_get(BV_OP_OR_ASSIGN);
+    assert(c.calls == 3 && c.words == 48 && c.bytes == 0);
+
+    // The words between the ends of the range, and those we looked through.
+    bv_set_range(v, 60, 200);
+    assert(bv_stats_get(BV_OP_SET_RANGE).words == 4);
+    assert(bv_find_next(v, 5) == 60);
+    assert(bv_stats_get(BV_OP_FIND_NEXT).words == 1);
+    assert(bv_find_next(v, 300) == 1000);
+    assert(bv_stats_get(BV_OP_FIND_NEXT).words == 1 + 12);
+    size_t pos[200], from = 0;
+    assert(bv_positions(v, &from, pos, 200) == 140);
+    assert(bv_stats_get(BV_OP_POSITIONS).words == 16);
+
+    // Vectors the or makes count as allocations, and the or into them too.
+    struct bv *u = bv_or(v, v);
+    assert(bv_stats_get(BV_OP_OR).calls == 1);
+    assert(bv_stats_get(BV_OP_OR_INTO).calls == 1);
+    assert(bv_stats_get(BV_OP_ALLOC).calls == 3);
+
+    // We never called these.
+    assert(bv_stats_get(BV_OP_SHIFT_DOWN).calls == 0);
+    assert(bv_stats_get(BV_OP_ARENA_NEW).calls == 0);
+
+    bv_stats_reset();
+    assert(bv_stats_get(BV_OP_NEW).calls == 0 && bv_stats_get(BV_OP_ALLOC).bytes == 0);
+
+    free(u);
+    free(v);
+    free(w);
+}
+
+static void *count_in_thread(void *arg)
+{
+    struct bv const *v = arg;
+    for (int i = 0; i < CALLS_PER_THREAD; i++)
+    {
+        assert(bv_count(v) == 1);
+    }
+    return NULL;
+}
+
+// Each thread counts in a table of its own; we see the sum, also after the
+// threads are gone.
+static void test_threads(void)
+{
+    bv_stats_reset();
+    struct bv *v = bv_set(bv_new(640), 17, true);
+    pthread_t threads[NO_THREADS];
+    for (int i = 0; i < NO_THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, count_in_thread, v);
+    }
+    for (int i = 0; i < NO_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    struct bv_stats_counts c = bv_stats_get(BV_OP_COUNT);
+    assert(c.calls == NO_THREADS * CALLS_PER_THREAD);
+    assert(c.words == 10 * NO_THREADS * CALLS_PER_THREAD);
+    free(v);
+}
+
+// The dumps mention the operations we called and no others.
+static void test_dump(void)
+{
+    bv_stats_reset();
+    struct bv *v = bv_new(100);
+    bv_shift_up(v, 3);
+
+    for (int json = 0; json < 2; json++)
+    {
+        FILE *f = tmpfile();
+        assert(f);
+        bv_stats_dump(f, json);
+        long size = ftell(f);
+        rewind(f);
+        char *buf = malloc((size_t)size + 1);
+        assert(buf); // We don't handle allocation errors
+        buf[fread(buf, 1, (size_t)size, f)] = '\0';
+        fclose(f);
+
+        assert(strstr(buf, "bv_shift_up") && strstr(buf, "bv_alloc"));
+        assert(!strstr(buf, "bv_shift_down"));
+        if (json)
+            assert(buf[0] == '{' && strstr(buf, "\"enabled\": true"));
+        free(buf);
+    }
+    free(v);
+}
+
+int main(void)
+{
+    for (size_t op = 0; op < BV_NO_OPS; op++)
+    {
+        assert(strncmp(bv_stats_name(op), "bv_", 3) == 0);
+    }
+    assert(strcmp(bv_stats_name(BV_OP_SHIFT_UP_OR_ASSIGN), "bv_shift_up_or_assign") == 0);
+
+    if (!bv_stats_enabled())
+    {
+        test_disabled();
+        return 0;
+    }
+    test_counts();
+    test_threads();
+    test_dump();
+    return 0;
+}
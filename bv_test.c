@@ -1,8 +1,10 @@
 #include "bv.h"
+#include "test_util.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static void test_creation(void)
 {
@@ -423,6 +425,379 @@ static void test_shift_down(void)
     free(v);
 }
 
+// Run the bulk operations with every instruction set the CPU supports,
+// on lengths that leave different tails after the SIMD part, and check
+// them bit by bit.
+static void test_isa(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 127, 128, 129, 255, 256, 257,
+                      511, 512, 513, 1000, 2047, 2048, 2049, 5000};
+    for (int isa = BV_ISA_SCALAR; isa <= BV_ISA_AVX512; isa++)
+    {
+        if (bv_isa_select((enum bv_isa)isa) != (enum bv_isa)isa)
+            continue; // not supported here
+
+        for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+        {
+            size_t n = sizes[s];
+            struct bv *v = random_vector(n);
+            struct bv *w = random_vector(n);
+
+            struct bv *or = bv_or(v, w);
+            struct bv *and = bv_and(v, w);
+            for (size_t i = 0; i < n; i++)
+            {
+                assert(bv_get(or, i) == (bv_get(v, i) | bv_get(w, i)));
+                assert(bv_get(and, i) == (bv_get(v, i) & bv_get(w, i)));
+            }
+
+            struct bv *u = bv_copy(v);
+            assert(bv_eq(u, v));
+            bv_or_assign(u, w);
+            assert(bv_eq(u, or));
+            free(u);
+
+            u = bv_copy(v);
+            bv_and_assign(u, w);
+            assert(bv_eq(u, and));
+
+            // Flipping any single bit must break equality.
+            for (size_t i = 0; i < n; i += 1 + n / 50)
+            {
+                bv_set(u, i, !bv_get(u, i));
+                assert(!bv_eq(u, and));
+                bv_set(u, i, !bv_get(u, i));
+                assert(bv_eq(u, and));
+            }
+
+            bv_neg(u);
+            for (size_t i = 0; i < n; i++)
+            {
+                assert(bv_get(u, i) == !bv_get(and, i));
+            }
+            bv_neg(bv_neg(u));
+            bv_and_assign(u, and); // ~and & and == 0
+            assert(bv_eq(u, bv_zero(w)));
+
+            bv_one(u);
+            for (size_t i = 0; i < n; i++)
+            {
+                assert(bv_get(u, i));
+            }
+            bv_neg(u); // The unused bits must be clean, so this is all zero
+            assert(bv_eq(u, w));
+
+            free(v);
+            free(w);
+            free(u);
+            free(or);
+            free(and);
+        }
+    }
+    bv_isa_select(BV_ISA_AVX512);
+}
+
+static void test_shift_up_or_assign(void)
+{
+    size_t sizes[] = {1, 5, 63, 64, 65, 150, 300};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        size_t n = sizes[s];
+        for (size_t k = 0; k <= n + 1; k++)
+        {
+            struct bv *v = random_vector(n);
+            struct bv *w = random_vector(n);
+            struct bv *expected = bv_or_assign(bv_shift_up(bv_copy(v), k), w);
+            bv_shift_up_or_assign(v, k, w);
+            assert(bv_eq(v, expected));
+            free(v);
+            free(w);
+            free(expected);
+        }
+    }
+}
+
+static void test_init_and_into(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 300};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        size_t n = sizes[s];
+        uint64_t buf[8];
+        assert(bv_size(n) <= sizeof buf);
+        memset(buf, 0xff, sizeof buf);
+        struct bv *u = bv_init(buf, n);
+        struct bv *zero = bv_new(n);
+        assert(u->len == n && bv_eq(u, zero));
+
+        struct bv *v = random_vector(n);
+        struct bv *w = random_vector(n);
+        struct bv *or = bv_or(v, w);
+        struct bv *and = bv_and(v, w);
+        assert(bv_eq(bv_or_into(u, v, w), or));
+        assert(bv_eq(bv_and_into(u, v, w), and));
+        assert(bv_eq(bv_copy_into(u, v), v));
+        // The destination may be one of the operands
+        assert(bv_eq(bv_or_into(u, u, w), or));
+
+        free(zero);
+        free(v);
+        free(w);
+        free(or);
+        free(and);
+    }
+}
+
+static void test_arena(void)
+{
+    struct bv_arena *arena = bv_arena_new(1024);
+    for (int round = 0; round < 2; round++)
+    {
+        struct bv *vs[100];
+        for (size_t i = 0; i < 100; i++)
+        {
+            size_t n = (i % 10 == 9) ? 20000 : i * 7; // some larger than a block
+            vs[i] = bv_arena_alloc(arena, n);
+            assert(vs[i]->len == n);
+            assert(((uintptr_t)vs[i]->data % 64) == 0);
+            for (size_t j = 0; j < n; j++)
+            {
+                assert(!bv_get(vs[i], j));
+            }
+            if (i % 2 == 0)
+                bv_one(vs[i]);
+        }
+        // None of them overlap
+        for (size_t i = 0; i < 100; i++)
+        {
+            for (size_t j = 0; j < vs[i]->len; j++)
+            {
+                assert(bv_get(vs[i], j) == (i % 2 == 0));
+            }
+        }
+        bv_arena_reset(arena);
+    }
+    bv_arena_free(arena);
+}
+
+static void test_ranges(void)
+{
+    size_t sizes[] = {1, 63, 64, 65, 200, 1000};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        size_t n = sizes[s];
+        for (int rep = 0; rep < 200; rep++)
+        {
+            size_t from = rng() % (n + 1);
+            size_t to = from + rng() % (n - from + 1);
+            struct bv *v = random_vector(n);
+
+            size_t count = 0;
+            for (size_t i = from; i < to; i++)
+            {
+                count += bv_get(v, i);
+            }
+            assert(bv_count_range(v, from, to) == count);
+
+            struct bv *set = bv_set_range(bv_copy(v), from, to);
+            struct bv *clear = bv_clear_range(bv_copy(v), from, to);
+            struct bv *flip = bv_flip_range(bv_copy(v), from, to);
+            for (size_t i = 0; i < n; i++)
+            {
+                bool in = from <= i && i < to;
+                assert(bv_get(set, i) == (in || bv_get(v, i)));
+                assert(bv_get(clear, i) == (!in && bv_get(v, i)));
+                assert(bv_get(flip, i) == (in != bv_get(v, i)));
+            }
+            // The bits beyond the end stay clean
+            if (n % 64)
+            {
+                assert((set->data[n / 64] >> (n % 64)) == 0);
+                assert((flip->data[n / 64] >> (n % 64)) == 0);
+            }
+            free(set);
+            free(clear);
+            free(flip);
+            free(v);
+        }
+    }
+}
+
+static void test_copy_bits(void)
+{
+    size_t sizes[] = {1, 63, 64, 65, 200, 1000};
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+        size_t n = sizes[s];
+        for (int rep = 0; rep < 200; rep++)
+        {
+            struct bv *src = random_vector(n);
+            struct bv *dst = random_vector(n);
+            size_t len = rng() % (n + 1);
+            size_t src_from = rng() % (n - len + 1);
+            size_t dst_from = rng() % (n - len + 1);
+
+            struct bv *expected = bv_copy(dst);
+            for (size_t i = 0; i < len; i++)
+            {
+                bv_set(expected, dst_from + i, bv_get(src, src_from + i));
+            }
+            bv_copy_bits(dst, dst_from, src, src_from, len);
+            assert(bv_eq(dst, expected));
+            free(expected);
+
+            // Within the same vector, with overlapping ranges
+            expected = bv_copy(src);
+            for (size_t i = 0; i < len; i++)
+            {
+                bv_set(expected, dst_from + i, bv_get(src, src_from + i));
+            }
+            bv_copy_bits(src, dst_from, src, src_from, len);
+            assert(bv_eq(src, expected));
+            free(expected);
+
+            free(src);
+            free(dst);
+        }
+    }
+}
+
+static void test_conversions(void)
+{
+    size_t sizes[] = {0, 1, 15, 16, 17, 63, 64, 65, 100, 128, 129, 1000};
+    for (int isa = BV_ISA_SCALAR; isa <= BV_ISA_AVX512; isa++)
+    {
+        if (bv_isa_select((enum bv_isa)isa) != (enum bv_isa)isa)
+            continue; // not supported here
+
+        for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+        {
+            size_t n = sizes[s];
+            struct bv *v = random_vector(n);
+            unsigned char *bytes = malloc(n + 1);
+            char *text = malloc(n + 1);
+            assert(bytes && text);
+
+            bv_unpack_bytes(v, bytes);
+            bv_format(v, text, '0', '1');
+            assert(text[n] == '\0');
+            for (size_t i = 0; i < n; i++)
+            {
+                assert(bytes[i] == bv_get(v, i));
+                assert(text[i] == (bv_get(v, i) ? '1' : '0'));
+            }
+
+            // Any byte but 0 (or '0' in text) is a one.
+            for (size_t i = 0; i < n; i++)
+            {
+                bytes[i] *= (unsigned char)(1 + rng() % 200);
+                if (text[i] == '1')
+                    text[i] = (char)('a' + rng() % 26);
+            }
+            struct bv *w = bv_pack_bytes(bv_new(n), bytes);
+            assert(bv_eq(v, w));
+            free(w);
+            w = bv_new_from_string(text);
+            assert(bv_eq(v, w));
+            bv_zero(w);
+            bv_pack_text(w, text);
+            assert(bv_eq(v, w));
+            free(w);
+
+            // Other characters, as bv_print() uses
+            bv_format(v, text, '.', '1');
+            for (size_t i = 0; i < n; i++)
+            {
+                assert(text[i] == (bv_get(v, i) ? '1' : '.'));
+            }
+
+            free(bytes);
+            free(text);
+            free(v);
+        }
+    }
+    bv_isa_select(BV_ISA_AVX512);
+
+    char buf[32];
+    struct bv *v = bv_new_from_string("1000" "0100" "1111" "0001" "101");
+    assert(strcmp(bv_format_hex(v, buf), "12f85") == 0);
+    free(v);
+    v = bv_new(0);
+    assert(strcmp(bv_format_hex(v, buf), "") == 0);
+    free(v);
+}
+
+// Counting and finding bits, against bit by bit loops, with every
+// instruction set and on densities from empty to full.
+static void test_count_and_find(void)
+{
+    size_t sizes[] = {0, 1, 63, 64, 65, 255, 256, 257, 1023, 1024, 1025, 5000, 20000};
+    for (int isa = BV_ISA_SCALAR; isa <= BV_ISA_AVX512; isa++)
+    {
+        if (bv_isa_select((enum bv_isa)isa) != (enum bv_isa)isa)
+            continue; // not supported here
+
+        for (size_t s = 0; s < sizeof sizes / sizeof *sizes; s++)
+        {
+            size_t n = sizes[s];
+            for (int density = 0; density < 4; density++)
+            {
+                struct bv *v = bv_new(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    bool b = density == 3 || (density == 1 && rng() % 100 == 0) ||
+                             (density == 2 && (rng() & 1));
+                    bv_set(v, i, b);
+                }
+
+                size_t count = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    count += bv_get(v, i);
+                }
+                assert(bv_count(v) == count);
+                assert(bv_count_range(v, 0, n) == count);
+
+                // Find next, for ones and zeros, from every position.
+                size_t next_one = n, next_zero = n;
+                for (size_t i = n; i-- > 0;)
+                {
+                    if (bv_get(v, i))
+                        next_one = i;
+                    else
+                        next_zero = i;
+                    assert(bv_find_next(v, i) == next_one);
+                    assert(bv_find_next_zero(v, i) == next_zero);
+                }
+                assert(bv_find_first(v) == next_one);
+                assert(bv_find_first_zero(v) == next_zero);
+                assert(bv_find_next(v, n) == n && bv_find_next_zero(v, n + 10) == n);
+
+                // The positions in batches of different sizes.
+                size_t batches[] = {1, 3, 64, 1000};
+                for (size_t b = 0; b < sizeof batches / sizeof *batches; b++)
+                {
+                    size_t pos[1000], k, from = 0, seen = 0, expected = bv_find_first(v);
+                    while ((k = bv_positions(v, &from, pos, batches[b])) > 0)
+                    {
+                        assert(k <= batches[b]);
+                        for (size_t j = 0; j < k; j++)
+                        {
+                            assert(pos[j] == expected);
+                            expected = bv_find_next(v, expected + 1);
+                        }
+                        seen += k;
+                    }
+                    assert(seen == count && expected == n && from == n);
+                }
+
+                free(v);
+            }
+        }
+    }
+    bv_isa_select(BV_ISA_AVX512);
+}
+
 int main(void)
 {
     test_creation();
@@ -432,6 +807,14 @@ int main(void)
     test_and();
     test_shift_up();
     test_shift_down();
+    test_isa();
+    test_shift_up_or_assign();
+    test_init_and_into();
+    test_arena();
+    test_ranges();
+    test_copy_bits();
+    test_conversions();
+    test_count_and_find();
 
     return 0;
 }
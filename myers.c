@@ -0,0 +1,266 @@
+// Myers' bit-parallel edit distance (Myers, 1999), with Hyyrö's extension
+// to patterns longer than a word (Hyyrö, 2003).
+//
+// Instead of the dynamic programming table for the edit distance between
+// the pattern and the text, we keep one column of it, encoded as the
+// differences between neighbouring cells. Going down a column, a cell
+// differs from the one above by -1, 0 or +1, so we can store the column as
+// two bit vectors, Pv (the +1s) and Mv (the -1s), and compute the next
+// column from them with a handful of word operations. A column of a
+// length-m pattern takes m / 64 words, so each text letter costs O(m / 64)
+// operations instead of the O(m) cells of the table.
+//
+// We split the vectors into 64-bit blocks (the words of a struct bv) and
+// process them top to bottom, passing the horizontal difference at the
+// bottom of each block on to the next, as the carry of the addition.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bv.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
+
+struct myers
+{
+    size_t m;
+    bool global;   // edit distance against the whole text, not a substring
+    struct bv **peq; // peq[a] has bit i set if p[i] == a
+    struct bv *Pv, *Mv;
+    size_t score; // the last row of the current column
+};
+
+static void myers_init(struct myers *my, size_t m, const char p[m], bool global) // FlawFinder: ignore
+{
+    my->m = m;
+    my->global = global;
+
+    // The SHIFT-and-OR masks have zeros where the letters match; here we
+    // want ones there.
+    my->peq = build_pattern_masks(m, p);
+    for (size_t a = 0; a < sigma; a++)
+    {
+        bv_neg(my->peq[a]);
+    }
+
+    // The first column is 0, 1, 2, ..., m, i.e. all +1.
+    my->Pv = bv_one(bv_new(m));
+    my->Mv = bv_new(m);
+    my->score = m;
+}
+
+static void myers_free(struct myers *my)
+{
+    free_pattern_masks(my->peq);
+    free(my->Pv);
+    free(my->Mv);
+}
+
+// One block of the column: updates the block's Pv and Mv for the letter
+// with match vector Eq, given the horizontal difference hin at the top of
+// the block. Returns the horizontal difference at bit `last` (the bottom
+// of the block, or the last row of the pattern in the last block).
+static inline int myers_block(uint64_t *Pv, uint64_t *Mv, uint64_t Eq, int hin, unsigned last)
+{
+    uint64_t hin_neg = (uint64_t)(hin < 0);
+    uint64_t hin_pos = (uint64_t)(hin > 0);
+
+    uint64_t Xv = Eq | *Mv;
+    Eq |= hin_neg;
+    uint64_t Xh = (((Eq & *Pv) + *Pv) ^ *Pv) | Eq;
+    uint64_t Ph = *Mv | ~(Xh | *Pv);
+    uint64_t Mh = *Pv & Xh;
+
+    int hout = (int)((Ph >> last) & 1) - (int)((Mh >> last) & 1);
+
+    Ph = (Ph << 1) | hin_pos;
+    Mh = (Mh << 1) | hin_neg;
+    *Pv = Mh | ~(Xv | Ph);
+    *Mv = Ph & Xv;
+
+    return hout;
+}
+
+// Advance to the next column and return the edit distance between the
+// pattern and the best substring of the text ending at this letter (or the
+// whole text read so far, for global distance).
+static size_t myers_step(struct myers *my, unsigned char a)
+{
+    size_t no_words = (my->m + 63) / 64;
+    uint64_t const *Eq = my->peq[a]->data;
+    uint64_t *Pv = my->Pv->data, *Mv = my->Mv->data;
+
+    // In the top row, a substring can start anywhere for free, so the
+    // row is all zeros; for global distance it counts the text letters.
+    int h = my->global ? 1 : 0;
+    for (size_t i = 0; i + 1 < no_words; i++)
+    {
+        h = myers_block(&Pv[i], &Mv[i], Eq[i], h, 63);
+    }
+    h = myers_block(&Pv[no_words - 1], &Mv[no_words - 1], Eq[no_words - 1],
+                    h, (unsigned)((my->m - 1) % 64));
+
+    my->score += h;
+    return my->score;
+}
+
+// MARK: Search
+enum report
+{
+    DISTANCE,  // global edit distance between pattern and text
+    BEST,      // end positions with the smallest semi-global distance
+    THRESHOLD, // end positions with distance at most k
+};
+
+struct positions
+{
+    size_t n, cap;
+    size_t *pos;
+};
+
+static void positions_add(struct positions *ps, size_t pos)
+{
+    if (ps->n == ps->cap)
+    {
+        ps->cap = ps->cap ? 2 * ps->cap : 64;
+        ps->pos = realloc(ps->pos, ps->cap * sizeof *ps->pos);
+        assert(ps->pos);
+    }
+    ps->pos[ps->n++] = pos;
+}
+
+static int scan(enum report report, size_t k, const char *p, const char *path)
+{
+    size_t m = strlen(p); // FlawFinder: ignore
+
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        return 1;
+    }
+    struct sao_out out;
+    sao_out_init(&out, STDOUT_FILENO);
+
+    struct myers my;
+    myers_init(&my, m, p, report == DISTANCE);
+
+    size_t best = m; // distance to an empty substring
+    struct positions ends = {0, 0, NULL};
+
+    size_t offset = 0;
+    const char *x;
+    for (size_t n; (n = sao_text_next(&text, &x)) > 0; offset += n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t d = myers_step(&my, (unsigned char)x[i]);
+            switch (report)
+            {
+            case DISTANCE:
+                break;
+            case BEST:
+                if (d < best)
+                {
+                    best = d;
+                    ends.n = 0;
+                }
+                if (d == best)
+                    positions_add(&ends, offset + i);
+                break;
+            case THRESHOLD:
+                if (d <= k)
+                {
+                    sao_out_size(&out, offset + i);
+                    sao_out_char(&out, '\t');
+                    sao_out_size(&out, d);
+                    sao_out_char(&out, '\n');
+                }
+                break;
+            }
+        }
+    }
+
+    // A read error means we didn't see all of the text, so no distance
+    // and no best positions.
+    int status = sao_text_failed(&text, path) ? 1 : 0;
+    if (report == DISTANCE && status == 0)
+    {
+        sao_out_size(&out, my.score);
+        sao_out_char(&out, '\n');
+    }
+    else if (report == BEST && status == 0)
+    {
+        for (size_t i = 0; i < ends.n; i++)
+        {
+            sao_out_size(&out, ends.pos[i]);
+            sao_out_char(&out, '\t');
+            sao_out_size(&out, best);
+            sao_out_char(&out, '\n');
+        }
+    }
+
+    sao_out_flush(&out);
+    if (sao_out_failed(&out))
+        status = 1;
+    free(ends.pos);
+    myers_free(&my);
+    sao_text_close(&text);
+
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -e pattern [file]\n"
+            "       %s -b pattern [file]\n"
+            "       %s -k k pattern [file]\n"
+            "\n"
+            "Reads the text from file (or stdin) and prints\n"
+            "  -e  the edit distance between the pattern and the text\n"
+            "  -b  the end positions of the substrings of the text closest\n"
+            "      to the pattern, and their edit distance\n"
+            "  -k  the end positions (and distances) of all substrings of\n"
+            "      the text within edit distance k of the pattern\n",
+            prog, prog, prog);
+}
+
+int main(int argc, const char *argv[])
+{
+    if ((argc == 3 || argc == 4) && (strcmp(argv[1], "-e") == 0 || strcmp(argv[1], "-b") == 0))
+    {
+        const char *p = argv[2];
+        const char *path = (argc == 4) ? argv[3] : NULL;
+        if (*p == '\0')
+        {
+            fprintf(stderr, "Empty pattern.\n");
+            return 1;
+        }
+        return scan(argv[1][1] == 'e' ? DISTANCE : BEST, 0, p, path);
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "-k") == 0)
+    {
+        char *end;
+        size_t k = strtoul(argv[2], &end, 10);
+        const char *p = argv[3];
+        const char *path = (argc == 5) ? argv[4] : NULL;
+        if (*argv[2] == '\0' || *end != '\0')
+        {
+            fprintf(stderr, "k must be a number, not %s.\n", argv[2]);
+            return 1;
+        }
+        if (*p == '\0')
+        {
+            fprintf(stderr, "Empty pattern.\n");
+            return 1;
+        }
+        return scan(THRESHOLD, k, p, path);
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,149 @@
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// myers -e, -b and -k against the dynamic programming table, for patterns
+// of one word, around the word boundaries and of several words.
+
+static const char *myers; // the program, from the command line
+
+// The last row of the table for p against x[0, n), column by column:
+// d[i] is the distance between p and the best substring ending at x[i],
+// or, if global, x[0, i] itself. Returns the distance to all of x.
+static size_t edit_distances(const char *x, size_t n, const char *p, size_t m,
+                             bool global, size_t d[])
+{
+    size_t *col = malloc((m + 1) * sizeof *col);
+    assert(col); // We don't handle allocation errors
+    for (size_t j = 0; j <= m; j++)
+        col[j] = j;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t diag = col[0];
+        col[0] = global ? i + 1 : 0;
+        for (size_t j = 1; j <= m; j++)
+        {
+            size_t best = diag + (p[j - 1] != x[i]);
+            if (col[j] + 1 < best)
+                best = col[j] + 1;
+            if (col[j - 1] + 1 < best)
+                best = col[j - 1] + 1;
+            diag = col[j];
+            col[j] = best;
+        }
+        d[i] = col[m];
+    }
+    size_t last = col[m];
+    free(col);
+    return last;
+}
+
+static void check(const char *x, size_t n, const char *p, size_t m, size_t k)
+{
+    char *path = temp_file(x, n);
+    char *pattern = malloc(m + 1);
+    assert(pattern); // We don't handle allocation errors
+    memcpy(pattern, p, m);
+    pattern[m] = '\0';
+    size_t *d = malloc((n + 1) * sizeof *d);
+    assert(d); // We don't handle allocation errors
+    size_t no, *got;
+
+    size_t dist = edit_distances(x, n, p, m, true, d);
+    got = run_tool(&no, "'%s' -e %s %s", myers, pattern, path);
+    assert(no == 1 && got[0] == dist);
+    free(got);
+
+    // The best end positions, with the distance m of an empty substring
+    // as the one to beat.
+    edit_distances(x, n, p, m, false, d);
+    size_t best = m;
+    for (size_t i = 0; i < n; i++)
+        best = (d[i] < best) ? d[i] : best;
+    got = run_tool(&no, "'%s' -b %s %s", myers, pattern, path);
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (d[i] == best)
+        {
+            assert(j + 1 < no && got[j] == i && got[j + 1] == best);
+            j += 2;
+        }
+    }
+    assert(j == no);
+    free(got);
+
+    // From a pipe rather than a mapped file.
+    got = run_tool(&no, "cat %s | '%s' -k %zu %s", path, myers, k, pattern);
+    j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (d[i] <= k)
+        {
+            assert(j + 1 < no && got[j] == i && got[j + 1] == d[i]);
+            j += 2;
+        }
+    }
+    assert(j == no);
+    free(got);
+
+    free(d);
+    free(pattern);
+    remove(path);
+    free(path);
+}
+
+static void random_string(char *x, size_t n, const char *alphabet, size_t letters)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = alphabet[rng() % letters];
+}
+
+static void test_random(void)
+{
+    size_t ms[] = {1, 2, 5, 63, 64, 65, 127, 128, 129, 200};
+    size_t ns[] = {0, 1, 10, 300};
+    const char *alphabets[] = {"ab", "acgt", "abcdefghijklmnopqrstuvwxyz"};
+    for (size_t a = 0; a < sizeof alphabets / sizeof *alphabets; a++)
+    {
+        const char *alphabet = alphabets[a];
+        size_t letters = strlen(alphabet); // FlawFinder: ignore
+        for (size_t i = 0; i < sizeof ms / sizeof *ms; i++)
+        {
+            for (size_t j = 0; j < sizeof ns / sizeof *ns; j++)
+            {
+                size_t m = ms[i], n = ns[j];
+                char *x = malloc(n + 1), *p = malloc(m);
+                assert(x && p); // We don't handle allocation errors
+                random_string(x, n, alphabet, letters);
+                random_string(p, m, alphabet, letters);
+                // Usually a piece of the text with a few edits, so there
+                // are close matches to find.
+                if (n >= m && rng() % 4 != 0)
+                {
+                    memcpy(p, x + rng() % (n - m + 1), m);
+                    for (size_t e = rng() % (m / 8 + 2); e > 0; e--)
+                        p[rng() % m] = alphabet[rng() % letters];
+                }
+                check(x, n, p, m, rng() % (m / 3 + 2));
+                free(x);
+                free(p);
+            }
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s path-to-myers\n", argv[0]);
+        return 1;
+    }
+    myers = argv[1];
+    test_random();
+    return 0;
+}
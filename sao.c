@@ -1,80 +1,568 @@
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "bv.h"
+#include "bv_fixed.h"
+#include "bv_par.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
 
-#define sigma 256 // size of alphabet (assumed one byte letters)
+// The educational version: the text is on the command line and we print
+// the state vector after each character.
+static int trace(const char *x, const char *p)
+{
+    size_t n = strlen(x); // FlawFinder: ignore
+    size_t m = strlen(p); // FlawFinder: ignore
+
+    struct bv **pmask = build_pattern_masks(m, p);
+    struct bv *match = bv_one(bv_new(m));
+
+    for (size_t i = 0; i < n; i++)
+    {
+        // match = (match << 1) | mask[x[i]]
+        bv_shift_up_or_assign(match, 1, pmask[(unsigned char)x[i]]);
+
+        if (bv_get(match, m - 1) == 0)
+        {
+            printf("match at: %lu\n", i - m + 1);
+        }
+
+        // Print state for educational purposes...
+        printf("%c ", x[i]);
+        bv_print(match);
+    }
+
+    free(match);
+    free_pattern_masks(pmask);
+
+    return 0;
+}
+
+// MARK: Streaming search
+enum report
+{
+    COUNT,   // just the number of matches
+    OFFSETS, // the offset of each match, one per line
+    FIRST,   // the offset of the first match, then stop
+};
+
+// The production version: the text comes from a file (or stdin) in chunks.
+// We split the text into pieces and search them in parallel. A match ending
+// in a piece can start up to m - 1 characters before it, so each piece is
+// scanned from m - 1 characters before its start, but only reports the
+// matches that end inside it. That way every match is found by exactly one
+// piece, and taking the pieces in order gives the matches in order. Between
+// chunks we keep the last m - 1 characters around for the same reason.
+
+#define PIECE_SIZE ((size_t)1 << 20) // text per task, if the pattern is short
+#define PIECES_PER_THREAD 4          // pieces per round, to even out the load
+
+// The matches found in one piece: their number and, unless we only count,
+// their offsets.
+struct hits
+{
+    size_t count;
+    size_t n, cap;
+    size_t *offsets;
+};
+
+struct search;
+// Scan x[start, to) from a fresh state, and record the matches that end in
+// [from, to); x[0] is at offset base in the text.
+typedef void scan_fn(struct search const *s, const char *x,
+                     size_t start, size_t from, size_t to, size_t base,
+                     struct hits *h);
+
+struct piece
+{
+    size_t start, from, to;
+    struct hits hits;
+};
+
+struct search
+{
+    enum report report;
+    size_t m;
+    void *pmask; // the pattern masks, in whatever form scan wants them
+    scan_fn *scan;
+    void (*free_masks)(void *pmask);
+
+    size_t piece_size, max_pieces;
+    struct piece *pieces;
+    size_t count;
+    struct sao_out out;
+};
 
-static struct bv **build_pattern_masks(size_t m, const char p[m]) // FlawFinder: ignore
+// Record a match starting at offset, and return false if we should stop.
+static inline bool hit(struct search const *s, struct hits *h, size_t offset)
 {
-    struct bv **pmask = malloc(sigma * sizeof *pmask);
-    assert(pmask);
+    h->count++;
+    if (s->report == COUNT)
+        return true;
+    if (h->n == h->cap)
+    {
+        h->cap = h->cap ? 2 * h->cap : 64;
+        h->offsets = realloc(h->offsets, h->cap * sizeof *h->offsets);
+        assert(h->offsets); // We don't handle allocation errors
+    }
+    h->offsets[h->n++] = offset;
+    return s->report != FIRST;
+}
+
+// Patterns of any length, with struct bv. The masks are the compact ones,
+// since for long patterns a full table of sigma vectors wouldn't fit in
+// the cache.
+static void scan_bv(struct search const *s, const char *x,
+                    size_t start, size_t from, size_t to, size_t base,
+                    struct hits *h)
+{
+    struct compact_masks const *pmask = s->pmask;
+    size_t m = s->m;
+    struct bv *match = bv_one(bv_new(m));
+
+    for (size_t i = start; i < from; i++)
+    {
+        bv_shift_up_or_assign(match, 1, compact_mask(pmask, (unsigned char)x[i]));
+    }
+    for (size_t i = from; i < to; i++)
+    {
+        bv_shift_up_or_assign(match, 1, compact_mask(pmask, (unsigned char)x[i]));
+        if (bv_get(match, m - 1) == 0 && !hit(s, h, base + i - m + 1))
+            break;
+    }
+
+    free(match);
+}
+
+// The same search for patterns that fit in a fixed-width vector, which the
+// compiler can keep in registers. We generate one for each width, and
+// scan() picks the smallest that fits.
+// clang-format off
+#define SCAN_FIXED(TYPE)                                                         \
+    static void *masks_##TYPE(size_t m, const char *p)                           \
+    {                                                                            \
+        struct TYPE *pmask = malloc(sigma * sizeof *pmask);                      \
+        assert(pmask); /* We don't handle allocation errors */                   \
+        struct bv **masks = build_pattern_masks(m, p);                           \
+        for (size_t a = 0; a < sigma; a++)                                       \
+        {                                                                        \
+            pmask[a] = TYPE##_from_bv(masks[a]);                                 \
+        }                                                                        \
+        free_pattern_masks(masks);                                               \
+        return pmask;                                                            \
+    }                                                                            \
+                                                                                 \
+    static void scan_##TYPE(struct search const *s, const char *x,               \
+                            size_t start, size_t from, size_t to, size_t base,   \
+                            struct hits *h)                                      \
+    {                                                                            \
+        struct TYPE const *pmask = s->pmask;                                     \
+        size_t m = s->m;                                                         \
+        size_t check_word = bv_widx(m - 1);                                      \
+        uint64_t check_bit = (uint64_t)1 << bv_bidx(m - 1);                      \
+                                                                                 \
+        struct TYPE match = TYPE##_one();                                        \
+        for (size_t i = start; i < from; i++)                                    \
+        {                                                                        \
+            match = TYPE##_shift_up_or(match, pmask[(unsigned char)x[i]]);       \
+        }                                                                        \
+        for (size_t i = from; i < to; i++)                                       \
+        {                                                                        \
+            match = TYPE##_shift_up_or(match, pmask[(unsigned char)x[i]]);       \
+            if (!(match.w[check_word] & check_bit) &&                            \
+                !hit(s, h, base + i - m + 1))                                    \
+                return;                                                          \
+        }                                                                        \
+    }
+// clang-format on
 
-    // Build table of all ones
+SCAN_FIXED(bvf64)
+SCAN_FIXED(bvf128)
+SCAN_FIXED(bvf256)
+SCAN_FIXED(bvf512)
+
+// MARK: BNDM
+// Backward Nondeterministic DAWG Matching (Navarro and Raffinot) slides a
+// window of m characters over the text and reads it backwards, from the
+// right end. The state D has bit i set if the last i + 1 characters read
+// are a factor of the pattern ending at p[m - 1 - i], so D & B[a] followed
+// by a shift up is the same step as in SHIFT-and-OR, with AND on the masks
+// of the reversed pattern. When the top bit is set, what we have read is a
+// prefix of the pattern, and the next window could start there. When D is
+// all zeros, what we have read is not in the pattern at all, so we shift
+// the window to the last prefix we saw, or past the whole window. On a
+// large alphabet that happens after a few characters, so most of the text
+// is never read.
+//
+// Windows start at `start` and end before `to`. Since start is m - 1
+// characters before from (or the beginning of the text), every window ends
+// at or after from, so we report every match we find.
+
+static void *bndm_masks_64(size_t m, const char *p)
+{
+    uint64_t *B = malloc(sigma * sizeof *B);
+    assert(B); // We don't handle allocation errors
+    struct bv **masks = build_bndm_masks(m, p);
     for (size_t a = 0; a < sigma; a++)
     {
-        pmask[a] = bv_set(
-            bv_one(bv_new(m)),
-            m, 0);
+        B[a] = masks[a]->data[0];
+    }
+    free_pattern_masks(masks);
+    return B;
+}
+
+static void scan_bndm_64(struct search const *s, const char *x,
+                         size_t start, size_t from, size_t to, size_t base,
+                         struct hits *h)
+{
+    (void)from;
+    uint64_t const *B = s->pmask;
+    size_t m = s->m;
+    uint64_t top = (uint64_t)1 << (m - 1);
+
+    for (size_t pos = start; pos + m <= to;)
+    {
+        size_t j = m, last = m;
+        // After reading k characters only bits k - 1 and up can be set,
+        // so D is either zero or has just the top bit when j reaches 0.
+        for (uint64_t D = ~(uint64_t)0; D; D <<= 1)
+        {
+            D &= B[(unsigned char)x[pos + --j]];
+            if (D & top)
+            {
+                if (j > 0)
+                    last = j; // a prefix of the pattern starts at pos + j
+                else if (!hit(s, h, base + pos))
+                    return;
+                else
+                    break;
+            }
+        }
+        pos += last;
     }
+}
+
+static void scan_bndm_bv(struct search const *s, const char *x,
+                         size_t start, size_t from, size_t to, size_t base,
+                         struct hits *h)
+{
+    (void)from;
+    struct compact_masks const *B = s->pmask;
+    size_t m = s->m;
+    struct bv *D = bv_new(m);
 
-    // Set matches to zero
+    for (size_t pos = start; pos + m <= to;)
+    {
+        size_t j = m, last = m;
+        for (bv_one(D);; bv_shift_up(D, 1))
+        {
+            bv_and_assign(D, compact_mask(B, (unsigned char)x[pos + --j]));
+            if (bv_find_first(D) == m)
+                break; // D is empty
+            if (bv_get(D, m - 1))
+            {
+                if (j > 0)
+                    last = j;
+                else if (!hit(s, h, base + pos))
+                    goto done;
+                else
+                    break;
+            }
+        }
+        pos += last;
+    }
+
+done:
+    free(D);
+}
+
+// MARK: Choosing the algorithm
+enum algorithm
+{
+    AUTO,
+    SHIFT_OR,
+    BNDM,
+};
+
+// BNDM reads about (n / m) log_sigma(m) characters where SHIFT-and-OR reads
+// all n, but it does more work per character, and in a less predictable
+// loop. It wins when the pattern carries enough bits, m log2(sigma), that
+// a window is rarely a factor of it for long. Measured on random text, the
+// crossover is at about 32 bits for one-word patterns and 128 for longer
+// ones, where each BNDM step goes through struct bv but SHIFT-and-OR up to
+// 512 still runs in registers. We estimate the alphabet from the pattern's
+// distinct letters, which errs on the side of SHIFT-and-OR.
+static enum algorithm pick_algorithm(size_t m, const char *p)
+{
+    bool seen[sigma] = {false};
+    size_t letters = 0;
     for (size_t i = 0; i < m; i++)
     {
-        // Set pmatch[a]'s i'th bit to 0 if there is an a
-        // at index i in the pattern.
-        bv_set(pmask[(unsigned)p[i]], i, 0);
+        if (!seen[(unsigned char)p[i]])
+        {
+            seen[(unsigned char)p[i]] = true;
+            letters++;
+        }
     }
+    size_t bits = m * (size_t)(63 - __builtin_clzll(letters)); // m floor(log2(letters))
+    return bits >= (m <= 64 ? 32 : 128) ? BNDM : SHIFT_OR;
+}
 
-    return pmask;
+static void search_init(struct search *s, enum report report, enum algorithm algorithm,
+                        size_t m, const char *p, unsigned threads)
+{
+    s->report = report;
+    s->m = m;
+    s->count = 0;
+    sao_out_init(&s->out, STDOUT_FILENO);
+
+    if (algorithm == AUTO)
+        algorithm = pick_algorithm(m, p);
+
+    // clang-format off
+    if (algorithm == BNDM && m <= 64) { s->pmask = bndm_masks_64(m, p); s->scan = scan_bndm_64; s->free_masks = free; }
+    else if (algorithm == BNDM) { s->pmask = build_compact_bndm_masks(m, p); s->scan = scan_bndm_bv; s->free_masks = free; }
+    else if (m <= 64)       { s->pmask = masks_bvf64(m, p);  s->scan = scan_bvf64;  s->free_masks = free; }
+    else if (m <= 128) { s->pmask = masks_bvf128(m, p); s->scan = scan_bvf128; s->free_masks = free; }
+    else if (m <= 256) { s->pmask = masks_bvf256(m, p); s->scan = scan_bvf256; s->free_masks = free; }
+    else if (m <= 512) { s->pmask = masks_bvf512(m, p); s->scan = scan_bvf512; s->free_masks = free; }
+    else               { s->pmask = build_compact_masks(m, p); s->scan = scan_bv; s->free_masks = free; }
+    // clang-format on
+
+    // Keep the m - 1 characters we scan twice small compared to a piece.
+    s->piece_size = (PIECE_SIZE > 16 * m) ? PIECE_SIZE : 16 * m;
+    s->max_pieces = PIECES_PER_THREAD * bv_par_threads(threads);
+    s->pieces = calloc(s->max_pieces, sizeof *s->pieces);
+    assert(s->pieces); // We don't handle allocation errors
 }
 
-static void free_pattern_masks(struct bv **pmask)
+static void search_free(struct search *s)
 {
-    for (size_t a = 0; a < sigma; a++)
+    for (size_t j = 0; j < s->max_pieces; j++)
     {
-        free(pmask[a]);
+        free(s->pieces[j].hits.offsets);
     }
-    free(pmask);
+    free(s->pieces);
+    s->free_masks(s->pmask);
 }
 
-int main(int argc, const char *argv[])
+struct round
+{
+    struct search const *s;
+    const char *x;
+    size_t base;
+    _Atomic size_t first_hit; // the first piece with a match, for FIRST
+};
+
+static void scan_piece(void *ctx, size_t j)
+{
+    struct round *r = ctx;
+    struct search const *s = r->s;
+    // When we only want the first match, a match in an earlier piece
+    // makes this one pointless.
+    if (s->report == FIRST && atomic_load(&r->first_hit) < j)
+        return;
+
+    struct piece *pc = &s->pieces[j];
+    s->scan(s, r->x, pc->start, pc->from, pc->to, r->base, &pc->hits);
+
+    if (s->report == FIRST && pc->hits.count > 0)
+    {
+        size_t first = atomic_load(&r->first_hit);
+        while (j < first && !atomic_compare_exchange_weak(&r->first_hit, &first, j))
+            ;
+    }
+}
+
+// Search for the matches in x[0, n) that end at or after from, where x[0]
+// is at offset base in the text. Returns false if we are done searching.
+static bool search_buffer(struct search *s, const char *x, size_t from, size_t n, size_t base)
 {
-    if (argc != 3)
+    while (from < n)
     {
-        fprintf(stderr, "Usage: %s string pattern\n", argv[0]);
-        return 1;
+        size_t no_pieces = 0;
+        for (; no_pieces < s->max_pieces && from < n; no_pieces++)
+        {
+            struct piece *pc = &s->pieces[no_pieces];
+            pc->start = (from > s->m - 1) ? from - (s->m - 1) : 0;
+            pc->from = from;
+            pc->to = (n - from > s->piece_size) ? from + s->piece_size : n;
+            pc->hits.count = pc->hits.n = 0;
+            from = pc->to;
+        }
+
+        struct round r = {s, x, base, SIZE_MAX};
+        bv_par_run(no_pieces, scan_piece, &r);
+
+        for (size_t j = 0; j < no_pieces; j++)
+        {
+            struct hits const *h = &s->pieces[j].hits;
+            s->count += h->count;
+            for (size_t k = 0; k < h->n; k++)
+            {
+                sao_out_size(&s->out, h->offsets[k]);
+                sao_out_char(&s->out, '\n');
+            }
+            if (s->report == FIRST && h->count > 0)
+                return false;
+        }
     }
+    return true;
+}
 
-    const char *x = argv[1];
-    const char *p = argv[2];
-    size_t n = strlen(x); // FlawFinder: ignore
+static int scan(enum report report, enum algorithm algorithm, unsigned threads,
+                const char *p, const char *path)
+{
     size_t m = strlen(p); // FlawFinder: ignore
 
-    struct bv **pmask = build_pattern_masks(m, p);
-    struct bv *match = bv_one(bv_new(m));
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        return 1;
+    }
 
-    for (size_t i = 0; i < n; i++)
+    struct search s;
+    search_init(&s, report, algorithm, m, p, threads);
+
+    // buf holds the last m - 1 characters of the text so far (kept of
+    // them, fewer at the start) followed by the next chunk, if we need both.
+    char *buf = NULL;
+    size_t kept = 0;
+    size_t offset = 0; // offset of the current chunk in the text
+    const char *x;
+    for (size_t n; (n = sao_text_next(&text, &x)) > 0; offset += n)
     {
-        // match = (match << 1) | mask[x[i]]
-        bv_or_assign(
-            bv_shift_up(match, 1),
-            pmask[(unsigned)x[i]]);
+        const char *y = x;
+        size_t len = n;
+        if (kept > 0)
+        {
+            buf = realloc(buf, kept + n);
+            assert(buf); // We don't handle allocation errors
+            memcpy(buf + kept, x, n);
+            y = buf;
+            len = kept + n;
+        }
+        if (!search_buffer(&s, y, kept, len, offset - kept))
+            break;
 
-        if (bv_get(match, m - 1) == 0)
+        size_t keep = (len < m - 1) ? len : m - 1;
+        if (keep > 0)
         {
-            printf("match at: %lu\n", i - m + 1);
+            if (y != buf)
+            {
+                buf = realloc(buf, keep);
+                assert(buf); // We don't handle allocation errors
+            }
+            memmove(buf, y + len - keep, keep);
         }
+        kept = keep;
+    }
 
-        // Print state for educational purposes...
-        printf("%c ", x[i]);
-        bv_print(match);
+    // A read error means we didn't see all of the text, so no count.
+    int status = sao_text_failed(&text, path) ? 1 : 0;
+    if (report == COUNT && status == 0)
+    {
+        sao_out_size(&s.out, s.count);
+        sao_out_char(&s.out, '\n');
     }
 
-    free(match);
-    free_pattern_masks(pmask);
+    sao_out_flush(&s.out);
+    if (sao_out_failed(&s.out))
+        status = 1;
+    free(buf);
+    search_free(&s);
+    sao_text_close(&text);
 
-    return 0;
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s string pattern\n"
+            "       %s -c|-o|-f [-t threads] [-a shift|bndm|auto] pattern [file]\n"
+            "\n"
+            "The first form prints the state vector for each character.\n"
+            "The second reads the text from file (or stdin) and prints\n"
+            "  -c  the number of matches\n"
+            "  -o  the offset of every match\n"
+            "  -f  the offset of the first match\n"
+            "searching with the given number of threads (default one per core)\n"
+            "and algorithm (default auto, which picks from the pattern).\n",
+            prog, prog);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc >= 3 && argv[1][0] == '-' && argv[1][1] && !argv[1][2])
+    {
+        int arg = 2; // the first argument after the mode and options
+        unsigned threads = 0;
+        enum algorithm algorithm = AUTO;
+        for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+        {
+            const char *opt = argv[arg], *val = argv[arg + 1];
+            if (strcmp(opt, "-t") == 0)
+            {
+                char *end;
+                threads = (unsigned)strtoul(val, &end, 10);
+                if (*val == '\0' || *end != '\0')
+                {
+                    fprintf(stderr, "threads must be a number, not %s.\n", val);
+                    return 1;
+                }
+            }
+            else if (strcmp(opt, "-a") == 0)
+            {
+                if (strcmp(val, "shift") == 0)
+                    algorithm = SHIFT_OR;
+                else if (strcmp(val, "bndm") == 0)
+                    algorithm = BNDM;
+                else if (strcmp(val, "auto") == 0)
+                    algorithm = AUTO;
+                else
+                {
+                    fprintf(stderr, "Unknown algorithm %s.\n", val);
+                    return 1;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (arg < argc && argc <= arg + 2)
+        {
+            const char *p = argv[arg];
+            const char *path = (argc == arg + 2) ? argv[arg + 1] : NULL;
+            if (*p == '\0')
+            {
+                fprintf(stderr, "Empty pattern.\n");
+                return 1;
+            }
+            switch (argv[1][1])
+            {
+            case 'c':
+                return scan(COUNT, algorithm, threads, p, path);
+            case 'o':
+                return scan(OFFSETS, algorithm, threads, p, path);
+            case 'f':
+                return scan(FIRST, algorithm, threads, p, path);
+            }
+        }
+    }
+    else if (argc == 3)
+    {
+        return trace(argv[1], argv[2]);
+    }
+
+    usage(argv[0]);
+    return 1;
 }
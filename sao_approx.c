@@ -0,0 +1,234 @@
+// Approximate matching with SHIFT-and-OR (Wu and Manber, 1992): find the
+// places where the pattern matches the text with at most k errors
+// (substitutions, insertions or deletions).
+//
+// We keep k + 1 state vectors, where R[j] holds the prefixes of the
+// pattern that match a suffix of the text read so far with at most j
+// errors. As in sao.c, a zero bit means a match. When we read letter a,
+// each vector is updated from the old and new versions of the one below:
+//
+//   R'[0] = (R[0] << 1) | pmask[a]
+//   R'[j] = ((R[j] << 1) | pmask[a])  // the letters match
+//           & R[j-1]                  // insertion: skip the text letter
+//           & (R[j-1] << 1)           // substitution
+//           & (R'[j-1] << 1)          // deletion: skip the pattern letter
+//
+// There is a match with j errors ending at the current letter when bit
+// m - 1 of R[j] is zero.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bv.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
+
+struct approx
+{
+    size_t m, k;
+    struct bv **pmask;
+    struct bv **R;      // k + 1 state vectors
+    uint64_t *carries;  // the bit carried between words, for each shift
+};
+
+static void approx_init(struct approx *ap, size_t k, size_t m, const char p[m]) // FlawFinder: ignore
+{
+    ap->m = m;
+    ap->k = k;
+    ap->pmask = build_pattern_masks(m, p);
+    ap->R = malloc((k + 1) * sizeof *ap->R);
+    ap->carries = malloc(2 * (k + 1) * sizeof *ap->carries);
+    assert(ap->R && ap->carries);
+
+    // Before we have seen any text, the first j letters of the pattern can
+    // be matched by deleting them, so R[j] starts out with j zeros.
+    for (size_t j = 0; j <= k; j++)
+    {
+        ap->R[j] = bv_one(bv_new(m));
+        for (size_t i = 0; i < j && i < m; i++)
+        {
+            bv_set(ap->R[j], i, 0);
+        }
+    }
+}
+
+static void approx_free(struct approx *ap)
+{
+    for (size_t j = 0; j <= ap->k; j++)
+    {
+        free(ap->R[j]);
+    }
+    free(ap->R);
+    free(ap->carries);
+    free_pattern_masks(ap->pmask);
+}
+
+// Update all the state vectors for letter a. Instead of a shift and an or
+// for each term, which would pass over the vectors several times, we go
+// through the words once and update all k + 1 vectors for each word,
+// carrying the bits between words in registers. Returns the smallest
+// number of errors for a match ending here, or k + 1 if there is none.
+static size_t approx_step(struct approx *ap, unsigned char a)
+{
+    size_t k = ap->k;
+    size_t no_words = (ap->m + 63) / 64;
+    uint64_t const *mask = ap->pmask[a]->data;
+    uint64_t *old_carry = ap->carries;       // from the old R[j] << 1
+    uint64_t *new_carry = ap->carries + k + 1; // from the new R'[j] << 1
+    memset(ap->carries, 0, 2 * (k + 1) * sizeof *ap->carries);
+
+    for (size_t i = 0; i < no_words; i++)
+    {
+        uint64_t b = mask[i];
+        uint64_t prev_old = 0, prev_new = 0; // R[j-1] and R'[j-1] words
+        for (size_t j = 0; j <= k; j++)
+        {
+            uint64_t old = ap->R[j]->data[i];
+            uint64_t new = (old << 1) | old_carry[j] | b;
+            if (j > 0)
+            {
+                new &= prev_old                           // insertion
+                       & ((prev_old << 1) | old_carry[j - 1]) // substitution
+                       & ((prev_new << 1) | new_carry[j - 1]); // deletion
+            }
+            ap->R[j]->data[i] = new;
+
+            // The carries for the next word. We read the carries for j - 1
+            // above before we overwrote them here.
+            if (j > 0)
+            {
+                old_carry[j - 1] = prev_old >> 63;
+                new_carry[j - 1] = prev_new >> 63;
+            }
+            prev_old = old;
+            prev_new = new;
+        }
+        old_carry[k] = prev_old >> 63;
+        new_carry[k] = prev_new >> 63;
+    }
+
+    for (size_t j = 0; j <= k; j++)
+    {
+        if (bv_get(ap->R[j], ap->m - 1) == 0)
+            return j;
+    }
+    return k + 1;
+}
+
+// MARK: Search
+enum report
+{
+    COUNT,   // just the number of matches
+    OFFSETS, // the end of each match and its number of errors
+    FIRST,   // the end of the first match and its number of errors
+};
+
+static int scan(enum report report, size_t k, const char *p, const char *path)
+{
+    size_t m = strlen(p); // FlawFinder: ignore
+    // Every position is within m errors of a match, so a larger k only
+    // costs vectors (and k + 1 could wrap around).
+    if (k > m)
+        k = m;
+
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        return 1;
+    }
+    struct sao_out out;
+    sao_out_init(&out, STDOUT_FILENO);
+
+    struct approx ap;
+    approx_init(&ap, k, m, p);
+
+    int status = 0;
+    size_t count = 0;
+    size_t offset = 0;
+    const char *x;
+    for (size_t n; (n = sao_text_next(&text, &x)) > 0; offset += n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t errors = approx_step(&ap, (unsigned char)x[i]);
+            if (errors > k)
+                continue;
+
+            count++;
+            if (report == COUNT)
+                continue;
+            sao_out_size(&out, offset + i);
+            sao_out_char(&out, '\t');
+            sao_out_size(&out, errors);
+            sao_out_char(&out, '\n');
+            if (report == FIRST)
+                goto done;
+        }
+    }
+    // A read error means we didn't see all of the text, so no count.
+    status = sao_text_failed(&text, path) ? 1 : 0;
+    if (report == COUNT && status == 0)
+    {
+        sao_out_size(&out, count);
+        sao_out_char(&out, '\n');
+    }
+
+done:
+    sao_out_flush(&out);
+    if (sao_out_failed(&out))
+        status = 1;
+    approx_free(&ap);
+    sao_text_close(&text);
+
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -c|-o|-f k pattern [file]\n"
+            "\n"
+            "Searches the text in file (or stdin) for matches of pattern with\n"
+            "at most k substitutions, insertions and deletions, and prints\n"
+            "  -c  the number of positions where a match ends\n"
+            "  -o  each position where a match ends, and its number of errors\n"
+            "  -f  the first position where a match ends, and its errors\n",
+            prog);
+}
+
+int main(int argc, const char *argv[])
+{
+    if ((argc == 4 || argc == 5) && argv[1][0] == '-' && argv[1][1] && !argv[1][2])
+    {
+        char *end;
+        size_t k = strtoul(argv[2], &end, 10);
+        const char *p = argv[3];
+        const char *path = (argc == 5) ? argv[4] : NULL;
+        if (*argv[2] == '\0' || *end != '\0')
+        {
+            fprintf(stderr, "k must be a number, not %s.\n", argv[2]);
+            return 1;
+        }
+        if (*p == '\0')
+        {
+            fprintf(stderr, "Empty pattern.\n");
+            return 1;
+        }
+        switch (argv[1][1])
+        {
+        case 'c':
+            return scan(COUNT, k, p, path);
+        case 'o':
+            return scan(OFFSETS, k, p, path);
+        case 'f':
+            return scan(FIRST, k, p, path);
+        }
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,136 @@
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sao_approx -c, -o and -f against the dynamic programming table for
+// approximate matching, for patterns around the word boundaries and
+// numbers of errors up to and far beyond the pattern length.
+
+static const char *sao_approx; // the program, from the command line
+
+// d[e] is the fewest errors in a match of p ending at x[e]: the last row
+// of the edit distance table where a match can start anywhere.
+static void errors(const char *x, size_t n, const char *p, size_t m, size_t d[])
+{
+    size_t *col = malloc((m + 1) * sizeof *col);
+    assert(col); // We don't handle allocation errors
+    for (size_t j = 0; j <= m; j++)
+        col[j] = j;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t diag = col[0];
+        col[0] = 0;
+        for (size_t j = 1; j <= m; j++)
+        {
+            size_t best = diag + (p[j - 1] != x[i]);
+            if (col[j] + 1 < best)
+                best = col[j] + 1;
+            if (col[j - 1] + 1 < best)
+                best = col[j - 1] + 1;
+            diag = col[j];
+            col[j] = best;
+        }
+        d[i] = col[m];
+    }
+    free(col);
+}
+
+static void check(const char *x, size_t n, const char *p, size_t m, size_t k)
+{
+    char *path = temp_file(x, n);
+    char *pattern = malloc(m + 1);
+    assert(pattern); // We don't handle allocation errors
+    memcpy(pattern, p, m);
+    pattern[m] = '\0';
+    size_t *d = malloc((n + 1) * sizeof *d);
+    assert(d); // We don't handle allocation errors
+    errors(x, n, p, m, d);
+
+    size_t no, *got = run_tool(&no, "'%s' -o %zu %s %s", sao_approx, k, pattern, path);
+    size_t j = 0, first = n;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (d[i] <= k)
+        {
+            assert(j + 1 < no && got[j] == i && got[j + 1] == d[i]);
+            j += 2;
+            first = (first == n) ? i : first;
+        }
+    }
+    assert(j == no);
+    free(got);
+
+    // From a pipe rather than a mapped file.
+    got = run_tool(&no, "cat %s | '%s' -c %zu %s", path, sao_approx, k, pattern);
+    assert(no == 1 && got[0] == j / 2);
+    free(got);
+    got = run_tool(&no, "'%s' -f %zu %s %s", sao_approx, k, pattern, path);
+    assert(no == ((first < n) ? 2 : 0));
+    assert(first == n || (got[0] == first && got[1] == d[first]));
+    free(got);
+
+    free(d);
+    free(pattern);
+    remove(path);
+    free(path);
+}
+
+static void random_string(char *x, size_t n, const char *alphabet, size_t letters)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = alphabet[rng() % letters];
+}
+
+static void test_random(void)
+{
+    size_t ms[] = {1, 2, 5, 63, 64, 65, 130};
+    size_t ns[] = {0, 1, 10, 500};
+    const char *alphabets[] = {"ab", "acgt", "abcdefghijklmnopqrstuvwxyz"};
+    for (size_t a = 0; a < sizeof alphabets / sizeof *alphabets; a++)
+    {
+        const char *alphabet = alphabets[a];
+        size_t letters = strlen(alphabet); // FlawFinder: ignore
+        for (size_t i = 0; i < sizeof ms / sizeof *ms; i++)
+        {
+            size_t m = ms[i];
+            // and k so large that k + 1 wraps around
+            size_t ks[] = {0, 1, 3, m / 4, m + 1, SIZE_MAX};
+            for (size_t j = 0; j < sizeof ns / sizeof *ns; j++)
+            {
+                size_t n = ns[j];
+                char *x = malloc(n + 1), *p = malloc(m);
+                assert(x && p); // We don't handle allocation errors
+                random_string(x, n, alphabet, letters);
+                random_string(p, m, alphabet, letters);
+                // Usually a piece of the text with a few substitutions,
+                // so there are matches with some errors.
+                if (n >= m && rng() % 4 != 0)
+                {
+                    memcpy(p, x + rng() % (n - m + 1), m);
+                    for (size_t e = rng() % (m / 8 + 2); e > 0; e--)
+                        p[rng() % m] = alphabet[rng() % letters];
+                }
+                for (size_t l = 0; l < sizeof ks / sizeof *ks; l++)
+                    check(x, n, p, m, ks[l]);
+                free(x);
+                free(p);
+            }
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s path-to-sao_approx\n", argv[0]);
+        return 1;
+    }
+    sao_approx = argv[1];
+    test_random();
+    return 0;
+}
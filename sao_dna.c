@@ -0,0 +1,431 @@
+// SHIFT-and-OR on DNA packed two bits per base.
+//
+// A genome stored as text takes a byte per base, but there are only four
+// bases, so two bits will do, and reading the text costs a quarter of the
+// I/O. `sao_dna -p` packs a text of A, C, G and T (in either case, with
+// line breaks ignored) into that format, and the search modes read it.
+//
+// The packed format is the number of bases as a little-endian 64-bit
+// integer, followed by the bases four to a byte: base i is in bits
+// 2 (i % 4) and 2 (i % 4) + 1 of byte i / 4, with A = 0, C = 1, G = 2 and
+// T = 3, and the unused bits of the last byte zero.
+//
+// With four letters, the pattern masks are a table of four vectors (the
+// compact masks from sao_pmask.h, with the pattern written in codes). For
+// patterns of up to 509 bases, in the fixed-width vectors from bv_fixed.h,
+// we go a byte, four bases, at a time. Since
+//
+//   D' = (((((D << 1) | B[c0]) << 1 | B[c1]) << 1 | B[c2]) << 1) | B[c3]
+//      = (D << 4) | (B[c0] << 3) | (B[c1] << 2) | (B[c2] << 1) | B[c3]
+//
+// the four steps for a byte are one shift and an OR with a mask we can
+// look up for the whole byte. The state after each of the four bases is
+// still there, shifted up by 3, 2, 1 and 0 bits (the masks have no bits
+// at m or above, so the later steps don't touch them), so bits m - 1 to
+// m + 2 of D' tell us which of the four bases end a match. That is why the
+// vectors need three bits to spare.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bv.h"
+#include "bv_fixed.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
+
+#define HEADER 8 // bytes before the bases
+
+// The code of a base, or -1 for anything else.
+static int base_code(unsigned char c)
+{
+    switch (c)
+    {
+    case 'A':
+    case 'a':
+        return 0;
+    case 'C':
+    case 'c':
+        return 1;
+    case 'G':
+    case 'g':
+        return 2;
+    case 'T':
+    case 't':
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+// MARK: Packing
+static int pack(const char *path)
+{
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        return 1;
+    }
+
+    size_t n = 0, cap = 1 << 20;
+    unsigned char *packed = calloc(cap, 1);
+    assert(packed); // We don't handle allocation errors
+
+    size_t offset = 0;
+    const char *x;
+    for (size_t len; (len = sao_text_next(&text, &x)) > 0; offset += len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            if (x[i] == '\n' || x[i] == '\r')
+                continue;
+            int code = base_code((unsigned char)x[i]);
+            if (code < 0)
+            {
+                fprintf(stderr, "Can only pack A, C, G and T, not '%c' at offset %zu.\n",
+                        x[i], offset + i);
+                free(packed);
+                sao_text_close(&text);
+                return 1;
+            }
+            if (n / 4 == cap)
+            {
+                packed = realloc(packed, 2 * cap);
+                assert(packed); // We don't handle allocation errors
+                memset(packed + cap, 0, cap);
+                cap *= 2;
+            }
+            packed[n / 4] |= (unsigned char)(code << (2 * (n % 4)));
+            n++;
+        }
+    }
+    if (sao_text_failed(&text, path))
+    {
+        free(packed);
+        sao_text_close(&text);
+        return 1;
+    }
+
+    struct sao_out out;
+    sao_out_init(&out, STDOUT_FILENO);
+    for (size_t i = 0; i < HEADER; i++)
+    {
+        sao_out_char(&out, (char)(n >> (8 * i)));
+    }
+    for (size_t i = 0; i < (n + 3) / 4; i++)
+    {
+        sao_out_char(&out, (char)packed[i]);
+    }
+    sao_out_flush(&out);
+    int status = sao_out_failed(&out) ? 1 : 0;
+
+    free(packed);
+    sao_text_close(&text);
+    return status;
+}
+
+// MARK: Searching
+enum report
+{
+    COUNT,   // just the number of matches
+    OFFSETS, // the offset of each match, one per line
+    FIRST,   // the offset of the first match, then stop
+};
+
+struct search;
+// Search x[0, len), where the first base is at position pos and the last
+// byte holds last_bases bases (1 to 4). Returns false if we should stop.
+typedef bool search_fn(struct search *s, unsigned char const *x, size_t len,
+                       size_t last_bases, size_t pos);
+
+struct search
+{
+    enum report report;
+    size_t m;
+    size_t count;
+    struct sao_out out;
+
+    struct compact_masks *masks;
+    struct bv const *mask[4]; // by code
+    search_fn *search_bytes;
+
+    // For patterns up to 509 bases, the state and masks as
+    // fixed-width vectors (of the type the search function was made for),
+    // and the four steps' masks by byte.
+    uint64_t state[8];
+    uint64_t base_mask[4][8];
+    void *table;
+
+    struct bv *match; // the state for longer patterns
+};
+
+// Record a match ending at base end, and return false if we should stop.
+static inline bool hit(struct search *s, size_t end)
+{
+    s->count++;
+    if (s->report == COUNT)
+        return true;
+    sao_out_size(&s->out, end + 1 - s->m);
+    sao_out_char(&s->out, '\n');
+    return s->report != FIRST;
+}
+
+// Patterns of up to 64 * WORDS - 3 bases in fixed-width vectors, a byte at
+// a time. Bit m - 1 + 3 - k of the state after a byte is the state after
+// its base k.
+// clang-format off
+#define DNA_FIXED(TYPE)                                                          \
+    static bool search_##TYPE(struct search *s, unsigned char const *x,          \
+                              size_t len, size_t last_bases, size_t pos)         \
+    {                                                                            \
+        struct TYPE const *table = s->table;                                     \
+        struct TYPE const *B = (struct TYPE const *)s->base_mask;                \
+        size_t m = s->m, full = (last_bases == 4) ? len : len - 1;               \
+        struct TYPE D;                                                           \
+        memcpy(&D, s->state, sizeof D);                                          \
+        size_t wi = bv_widx(m - 1), bi = bv_bidx(m - 1);                         \
+        bool spill = bi > 60 && wi + 1 < sizeof D.w / sizeof *D.w;               \
+                                                                                 \
+        bool go = true;                                                          \
+        for (size_t i = 0; i < full && go; i++, pos += 4)                        \
+        {                                                                        \
+            D = TYPE##_or(TYPE##_shift_up(D, 4), table[x[i]]);                   \
+            /* The four end bits, m - 1 to m + 2, usually all ones. */           \
+            uint64_t ends = D.w[wi] >> bi;                                       \
+            if (spill)                                                           \
+                ends |= D.w[wi + 1] << (64 - bi);                                \
+            if ((ends & 0xf) == 0xf)                                             \
+                continue;                                                        \
+            for (size_t k = 0; k < 4 && go; k++)                                 \
+                go = ((ends >> (3 - k)) & 1) || hit(s, pos + k);                 \
+        }                                                                        \
+        for (size_t k = 0; full < len && k < last_bases && go; k++, pos++)       \
+        {                                                                        \
+            D = TYPE##_shift_up_or(D, B[(x[full] >> (2 * k)) & 3]);              \
+            go = TYPE##_get(D, m - 1) || hit(s, pos);                            \
+        }                                                                        \
+                                                                                 \
+        memcpy(s->state, &D, sizeof D);                                          \
+        return go;                                                               \
+    }                                                                            \
+                                                                                 \
+    static void init_##TYPE(struct search *s)                                    \
+    {                                                                            \
+        struct TYPE B[4];                                                        \
+        for (size_t c = 0; c < 4; c++)                                           \
+            B[c] = TYPE##_from_bv(s->mask[c]);                                   \
+        memcpy(s->base_mask, B, sizeof B);                                       \
+                                                                                 \
+        struct TYPE *table = malloc(256 * sizeof *table);                        \
+        assert(table); /* We don't handle allocation errors */                   \
+        for (size_t b = 0; b < 256; b++)                                         \
+        {                                                                        \
+            struct TYPE t = TYPE##_zero();                                       \
+            for (size_t k = 0; k < 4; k++)                                       \
+                t = TYPE##_or(t, TYPE##_shift_up(B[(b >> (2 * k)) & 3], 3 - k)); \
+            table[b] = t;                                                        \
+        }                                                                        \
+        s->table = table;                                                        \
+                                                                                 \
+        struct TYPE one = TYPE##_one();                                          \
+        memcpy(s->state, &one, sizeof one);                                      \
+        s->search_bytes = search_##TYPE;                                         \
+    }
+// clang-format on
+
+DNA_FIXED(bvf64)
+DNA_FIXED(bvf128)
+DNA_FIXED(bvf256)
+DNA_FIXED(bvf512)
+
+// Longer patterns, a base at a time with struct bv.
+static bool search_bv(struct search *s, unsigned char const *x, size_t len,
+                      size_t last_bases, size_t pos)
+{
+    size_t m = s->m;
+    for (size_t i = 0; i < len; i++)
+    {
+        size_t bases = (i + 1 < len) ? 4 : last_bases;
+        for (size_t k = 0; k < bases; k++, pos++)
+        {
+            bv_shift_up_or_assign(s->match, 1, s->mask[(x[i] >> (2 * k)) & 3]);
+            if (bv_get(s->match, m - 1) == 0 && !hit(s, pos))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void search_init(struct search *s, enum report report, size_t m, const char *codes)
+{
+    s->report = report;
+    s->m = m;
+    s->count = 0;
+    sao_out_init(&s->out, STDOUT_FILENO);
+
+    s->masks = build_compact_masks(m, codes);
+    for (unsigned char c = 0; c < 4; c++)
+    {
+        s->mask[c] = compact_mask(s->masks, c);
+    }
+    s->table = NULL;
+    s->match = NULL;
+
+    // clang-format off
+    if (m <= 64 - 3)       init_bvf64(s);
+    else if (m <= 128 - 3) init_bvf128(s);
+    else if (m <= 256 - 3) init_bvf256(s);
+    else if (m <= 512 - 3) init_bvf512(s);
+    else                   { s->match = bv_one(bv_new(m)); s->search_bytes = search_bv; }
+    // clang-format on
+}
+
+static void search_free(struct search *s)
+{
+    free(s->masks);
+    free(s->table);
+    free(s->match);
+}
+
+static int scan(enum report report, const char *p, const char *path)
+{
+    size_t m = strlen(p); // FlawFinder: ignore
+    char *codes = malloc(m);
+    assert(codes); // We don't handle allocation errors
+    for (size_t i = 0; i < m; i++)
+    {
+        int code = base_code((unsigned char)p[i]);
+        if (code < 0)
+        {
+            fprintf(stderr, "The pattern can only have A, C, G and T, not '%c'.\n", p[i]);
+            free(codes);
+            return 1;
+        }
+        codes[i] = (char)code;
+    }
+
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        free(codes);
+        return 1;
+    }
+
+    struct search s;
+    search_init(&s, report, m, codes);
+    free(codes);
+
+    int status = 0;
+    size_t left = 0; // bases still to come
+    size_t pos = 0;  // position of the next base
+    bool header = true, stopped = false;
+    const char *x;
+    for (size_t n; (n = sao_text_next(&text, &x)) > 0;)
+    {
+        unsigned char const *y = (unsigned char const *)x;
+        if (header)
+        {
+            // Chunks are only short at the end of the input, so the header
+            // is all in the first one.
+            if (n < HEADER)
+            {
+                fprintf(stderr, "The text is not packed DNA.\n");
+                status = 1;
+                break;
+            }
+            for (size_t i = 0; i < HEADER; i++)
+            {
+                left |= (size_t)y[i] << (8 * i);
+            }
+            y += HEADER;
+            n -= HEADER;
+            header = false;
+        }
+
+        // The bytes left, without overflowing on a corrupt count.
+        size_t left_bytes = left / 4 + (left % 4 != 0);
+        size_t bytes = (n < left_bytes) ? n : left_bytes;
+        size_t bases = (bytes < left_bytes) ? 4 * bytes : left;
+        size_t last_bases = bases - 4 * (bytes ? bytes - 1 : 0);
+        if (bytes > 0 && !s.search_bytes(&s, y, bytes, last_bases, pos))
+        {
+            stopped = true;
+            break;
+        }
+        pos += bases;
+        left -= bases;
+    }
+
+    // A read error means we didn't see all of the text, and so does a text
+    // shorter than its header says, so no count.
+    if (sao_text_failed(&text, path))
+    {
+        status = 1;
+    }
+    else if (status == 0 && !stopped && (header || left > 0))
+    {
+        fprintf(stderr, "Truncated packed text.\n");
+        status = 1;
+    }
+    if (report == COUNT && status == 0)
+    {
+        sao_out_size(&s.out, s.count);
+        sao_out_char(&s.out, '\n');
+    }
+
+    sao_out_flush(&s.out);
+    if (sao_out_failed(&s.out))
+        status = 1;
+    search_free(&s);
+    sao_text_close(&text);
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -p [file]\n"
+            "       %s -c|-o|-f pattern [file]\n"
+            "\n"
+            "The first form packs the DNA text in file (or stdin) two bits per\n"
+            "base and writes it to stdout. The second searches packed text from\n"
+            "file (or stdin) and prints\n"
+            "  -c  the number of matches\n"
+            "  -o  the offset of every match, in bases\n"
+            "  -f  the offset of the first match, in bases\n",
+            prog, prog);
+}
+
+int main(int argc, const char *argv[])
+{
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "-p") == 0)
+    {
+        return pack(argc == 3 ? argv[2] : NULL);
+    }
+    if ((argc == 3 || argc == 4) && argv[1][0] == '-' && argv[1][1] && !argv[1][2])
+    {
+        const char *p = argv[2];
+        const char *path = (argc == 4) ? argv[3] : NULL;
+        if (*p == '\0')
+        {
+            fprintf(stderr, "Empty pattern.\n");
+            return 1;
+        }
+        switch (argv[1][1])
+        {
+        case 'c':
+            return scan(COUNT, p, path);
+        case 'o':
+            return scan(OFFSETS, p, path);
+        case 'f':
+            return scan(FIRST, p, path);
+        }
+    }
+
+    usage(argv[0]);
+    return 1;
+}
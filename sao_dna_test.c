@@ -0,0 +1,163 @@
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Pack texts with sao_dna -p, search them with -c, -o and -f, and compare
+// with a brute-force search. The pattern lengths are around the switches
+// between the fixed-width vectors and struct bv, and the text lengths
+// leave the last byte full or holding one to three bases.
+
+static const char *sao_dna; // the program, from the command line
+
+static size_t *brute_force(const char *x, size_t n, const char *p, size_t m, size_t *no)
+{
+    size_t *hits = malloc((n + 1) * sizeof *hits);
+    assert(hits); // We don't handle allocation errors
+    *no = 0;
+    for (size_t i = 0; i + m <= n; i++)
+    {
+        if (memcmp(x + i, p, m) == 0)
+            hits[(*no)++] = i;
+    }
+    return hits;
+}
+
+static void check(const char *x, size_t n, const char *p, size_t m)
+{
+    // The text as the packer reads it, in lines and in mixed case.
+    char *text = malloc(n + n / 60 + 1);
+    assert(text); // We don't handle allocation errors
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        text[len++] = (i % 7 == 0) ? (char)(x[i] - 'A' + 'a') : x[i];
+        if (i % 60 == 59)
+            text[len++] = '\n';
+    }
+    char *text_path = temp_file(text, len);
+    char *packed_path = temp_file("", 0);
+    char *pattern = malloc(m + 1);
+    assert(pattern); // We don't handle allocation errors
+    memcpy(pattern, p, m);
+    pattern[m] = '\0';
+
+    size_t k, no;
+    free(run_tool(&k, "'%s' -p %s > %s", sao_dna, text_path, packed_path));
+    size_t *expected = brute_force(x, n, p, m, &no);
+
+    size_t *got = run_tool(&k, "'%s' -o %s %s", sao_dna, pattern, packed_path);
+    assert(k == no && memcmp(got, expected, no * sizeof *got) == 0);
+    free(got);
+    got = run_tool(&k, "'%s' -c %s %s", sao_dna, pattern, packed_path);
+    assert(k == 1 && got[0] == no);
+    free(got);
+    // From a pipe rather than a mapped file.
+    got = run_tool(&k, "cat %s | '%s' -f %s", packed_path, sao_dna, pattern);
+    assert(k == (no > 0) && (no == 0 || got[0] == expected[0]));
+    free(got);
+
+    free(expected);
+    free(pattern);
+    remove(packed_path);
+    remove(text_path);
+    free(packed_path);
+    free(text_path);
+    free(text);
+}
+
+static void random_dna(char *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = "ACGT"[rng() % 4];
+}
+
+static void test_round_trip(void)
+{
+    size_t ms[] = {1, 2, 3, 4, 5, 61, 62, 63, 125, 126, 253, 254, 509, 510, 511, 700};
+    for (size_t i = 0; i < sizeof ms / sizeof *ms; i++)
+    {
+        size_t m = ms[i];
+        size_t ns[] = {m - 1, m, m + 3, 2000, 2001, 2002, 2003};
+        for (size_t j = 0; j < sizeof ns / sizeof *ns; j++)
+        {
+            size_t n = ns[j];
+            char *x = malloc(n + m), *p = malloc(m);
+            assert(x && p); // We don't handle allocation errors
+
+            // Random text, with the pattern a piece of it.
+            random_dna(x, n);
+            random_dna(p, m);
+            if (n >= m)
+                memcpy(p, x + rng() % (n - m + 1), m);
+            check(x, n, p, m);
+
+            // A periodic text, where matches overlap.
+            size_t period = 1 + rng() % 5;
+            random_dna(x, period);
+            for (size_t k = period; k < n; k++)
+                x[k] = x[k - period];
+            memcpy(p, x, (m < n) ? m : n);
+            if (m > n)
+                random_dna(p + n, m - n);
+            check(x, n, p, m);
+
+            free(x);
+            free(p);
+        }
+    }
+}
+
+// More than one chunk of input, and a match across the end of the first.
+static void test_chunks(void)
+{
+    size_t chunk = (size_t)1 << 22, m = 62;
+    size_t n = 4 * chunk + 4 * 1000 + 1;
+    char *x = malloc(n);
+    assert(x); // We don't handle allocation errors
+    random_dna(x, n);
+    // The first chunk has the header and 4 (chunk - 8) bases.
+    size_t end = 4 * (chunk - 8);
+    char *p = x + end - m / 2;
+    memcpy(x + end + 1000, p, m);
+    check(x, n, p, m);
+    free(x);
+}
+
+// A packed text shorter than its header says is an error.
+static void test_truncated(void)
+{
+    char x[1001];
+    random_dna(x, sizeof x);
+    char *text_path = temp_file(x, sizeof x);
+    char *packed_path = temp_file("", 0);
+    size_t k;
+    free(run_tool(&k, "'%s' -p %s > %s", sao_dna, text_path, packed_path));
+
+    assert(run_status("'%s' -c A %s 2> /dev/null", sao_dna, packed_path) == 0);
+    int status = run_status("head -c 200 %s | '%s' -c A 2> /dev/null", packed_path, sao_dna);
+    assert(status != 0);
+    status = run_status("head -c 4 %s | '%s' -c A 2> /dev/null", packed_path, sao_dna);
+    assert(status != 0);
+
+    remove(packed_path);
+    remove(text_path);
+    free(packed_path);
+    free(text_path);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s path-to-sao_dna\n", argv[0]);
+        return 1;
+    }
+    sao_dna = argv[1];
+    test_round_trip();
+    test_chunks();
+    test_truncated();
+    return 0;
+}
@@ -0,0 +1,187 @@
+#define _DEFAULT_SOURCE // for madvise()
+
+#include "sao_io.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE ((size_t)1 << 22) // 4 MiB per read()
+
+// MARK: Text input
+bool sao_text_open(struct sao_text *text, const char *path)
+{
+    memset(text, 0, sizeof *text);
+
+    if (path == NULL || strcmp(path, "-") == 0)
+    {
+        text->fd = STDIN_FILENO;
+    }
+    else
+    {
+        text->fd = open(path, O_RDONLY); // FlawFinder: ignore
+        if (text->fd < 0)
+            return false;
+    }
+
+    struct stat st;
+    if (fstat(text->fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        text->mapped = true;
+        text->size = (size_t)st.st_size;
+        if (text->size == 0)
+        {
+            // Can't map an empty file, but there is nothing to read anyway.
+            text->done = true;
+            return true;
+        }
+        void *map = mmap(NULL, text->size, PROT_READ, MAP_PRIVATE, text->fd, 0);
+        if (map == MAP_FAILED)
+        {
+            int err = errno;
+            sao_text_close(text);
+            errno = err;
+            return false;
+        }
+        madvise(map, text->size, MADV_SEQUENTIAL); // just a hint; ignore errors
+        text->data = map;
+        return true;
+    }
+
+    text->size = CHUNK_SIZE;
+    text->data = malloc(CHUNK_SIZE);
+    assert(text->data); // We don't handle allocation errors
+    return true;
+}
+
+void sao_text_close(struct sao_text *text)
+{
+    if (text->mapped)
+    {
+        if (text->data)
+            munmap((void *)text->data, text->size);
+    }
+    else
+    {
+        free((void *)text->data);
+    }
+    if (text->fd > STDIN_FILENO)
+        close(text->fd);
+    text->data = NULL;
+    text->fd = -1;
+}
+
+size_t sao_text_next(struct sao_text *text, const char **chunk)
+{
+    if (text->done)
+        return 0;
+
+    if (text->mapped)
+    {
+        text->done = true;
+        *chunk = text->data;
+        return text->size;
+    }
+
+    // Fill the buffer as far as we can, so chunks stay large even when
+    // a pipe hands us the data in small pieces.
+    char *buf = (char *)text->data;
+    size_t len = 0;
+    while (len < text->size)
+    {
+        ssize_t n = read(text->fd, buf + len, text->size - len); // FlawFinder: ignore
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            // End of file, or an error; either way there is no more text.
+            if (n < 0)
+                text->error = errno;
+            text->done = true;
+            break;
+        }
+        len += (size_t)n;
+    }
+    *chunk = buf;
+    return len;
+}
+
+bool sao_text_failed(struct sao_text const *text, const char *path)
+{
+    if (!text->error)
+        return false;
+    errno = text->error;
+    perror((path == NULL || strcmp(path, "-") == 0) ? "stdin" : path);
+    return true;
+}
+
+// MARK: Output
+void sao_out_init(struct sao_out *out, int fd)
+{
+    out->fd = fd;
+    out->error = 0;
+    out->len = 0;
+}
+
+void sao_out_flush(struct sao_out *out)
+{
+    size_t written = 0;
+    while (!out->error && written < out->len)
+    {
+        ssize_t n = write(out->fd, out->buf + written, out->len - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            // Nowhere to write to; remember why, and drop the output.
+            out->error = n < 0 ? errno : EIO;
+            break;
+        }
+        written += (size_t)n;
+    }
+    out->len = 0;
+}
+
+bool sao_out_failed(struct sao_out const *out)
+{
+    if (!out->error)
+        return false;
+    errno = out->error;
+    perror("write");
+    return true;
+}
+
+void sao_out_char(struct sao_out *out, char c)
+{
+    if (out->len == sizeof out->buf)
+        sao_out_flush(out);
+    out->buf[out->len++] = c;
+}
+
+void sao_out_str(struct sao_out *out, const char *str)
+{
+    for (; *str; str++)
+        sao_out_char(out, *str);
+}
+
+void sao_out_size(struct sao_out *out, size_t x)
+{
+    char digits[24];
+    size_t n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x);
+
+    if (out->len + n > sizeof out->buf)
+        sao_out_flush(out);
+    while (n)
+        out->buf[out->len++] = digits[--n];
+}
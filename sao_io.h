@@ -0,0 +1,56 @@
+#ifndef SAO_IO_H
+#define SAO_IO_H
+
+// Input and output for the pattern matching programs, for texts that are
+// too large for the command line.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// MARK: Text input
+// A text source hands out the text in chunks. Regular files are memory
+// mapped and come out as a single chunk; anything else (pipes, stdin) is
+// read in large chunks into a buffer that is reused between calls, so a
+// chunk is only valid until the next call.
+struct sao_text
+{
+    int fd;
+    bool mapped;
+    const char *data; // the mapping, or the read buffer
+    size_t size;      // size of the mapping / capacity of the buffer
+    bool done;
+    int error; // errno of a failed read, 0 if none
+};
+
+// Opens the file at path, or stdin if path is NULL or "-".
+// Returns false and sets errno if the file can't be opened or mapped.
+bool sao_text_open(struct sao_text *text, const char *path);
+void sao_text_close(struct sao_text *text);
+
+// Points *chunk at the next piece of the text and returns its length.
+// Returns 0 at the end of the text, and also after a read error, so check
+// sao_text_failed() before trusting that we saw all of it.
+size_t sao_text_next(struct sao_text *text, const char **chunk);
+// If a read failed, report it with perror() for path and return true.
+bool sao_text_failed(struct sao_text const *text, const char *path);
+
+// MARK: Output
+// A small buffered writer, so reporting millions of matches doesn't cost
+// a printf() or a system call each.
+struct sao_out
+{
+    int fd;
+    int error; // errno of a failed write, 0 if none; we drop the rest
+    size_t len;
+    char buf[1 << 16];
+};
+
+void sao_out_init(struct sao_out *out, int fd);
+void sao_out_flush(struct sao_out *out);
+// If a write failed, report it with perror() and return true.
+bool sao_out_failed(struct sao_out const *out);
+void sao_out_str(struct sao_out *out, const char *str);
+void sao_out_size(struct sao_out *out, size_t x); // x in decimal
+void sao_out_char(struct sao_out *out, char c);
+
+#endif // SAO_IO_H
@@ -0,0 +1,275 @@
+// SHIFT-and-OR for many patterns at once. The patterns are concatenated
+// into a single state vector, so we scan the text once no matter how many
+// patterns there are, and each step costs one pass over the words of the
+// combined state instead of one pass per pattern.
+
+#define _POSIX_C_SOURCE 200809L // for getline()
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bv.h"
+#include "bv_rank.h"
+#include "sao_io.h"
+#include "sao_pmask.h"
+
+struct patterns
+{
+    size_t n;       // number of patterns
+    size_t len;     // total length, i.e., bits in the state vector
+    char **p;       // the patterns
+    size_t *offset; // where each pattern starts in the state vector
+};
+
+// MARK: Patterns
+static bool read_patterns(struct patterns *pats, const char *path)
+{
+    FILE *f = fopen(path, "r"); // FlawFinder: ignore
+    if (!f)
+        return false;
+
+    size_t cap = 16;
+    pats->n = pats->len = 0;
+    pats->p = malloc(cap * sizeof *pats->p);
+    pats->offset = malloc(cap * sizeof *pats->offset);
+    assert(pats->p && pats->offset);
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    for (ssize_t len; (len = getline(&line, &line_cap, f)) >= 0;)
+    {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0)
+            continue; // skip blank lines; an empty pattern matches everywhere
+
+        if (pats->n == cap)
+        {
+            cap *= 2;
+            pats->p = realloc(pats->p, cap * sizeof *pats->p);
+            pats->offset = realloc(pats->offset, cap * sizeof *pats->offset);
+            assert(pats->p && pats->offset);
+        }
+        pats->p[pats->n] = strdup(line);
+        assert(pats->p[pats->n]);
+        pats->offset[pats->n] = pats->len;
+        pats->len += (size_t)len;
+        pats->n++;
+    }
+    free(line);
+    fclose(f);
+    return true;
+}
+
+static size_t pattern_length(struct patterns const *pats, size_t j)
+{
+    size_t end = (j + 1 < pats->n) ? pats->offset[j + 1] : pats->len;
+    return end - pats->offset[j];
+}
+
+static void free_patterns(struct patterns *pats)
+{
+    for (size_t i = 0; i < pats->n; i++)
+        free(pats->p[i]);
+    free(pats->p);
+    free(pats->offset);
+}
+
+// Like build_pattern_masks() in sao.c, but with the patterns laid out one
+// after another in the same vectors. A bit is zero if the pattern has the
+// letter at that position.
+static struct bv **build_multi_pattern_masks(struct patterns const *pats)
+{
+    struct bv **pmask = alloc_pattern_masks(pats->len);
+    for (size_t j = 0; j < pats->n; j++)
+    {
+        for (size_t i = 0; pats->p[j][i]; i++)
+        {
+            bv_set(pmask[(unsigned char)pats->p[j][i]], pats->offset[j] + i, 0);
+        }
+    }
+
+    return pmask;
+}
+
+// The last bit of each pattern. When one of these is zero, that pattern
+// matches, and since they are also the bits that would carry into the next
+// pattern when we shift, we clear them before shifting.
+static struct bv *build_end_mask(struct patterns const *pats)
+{
+    struct bv *ends = bv_new(pats->len);
+    for (size_t j = 0; j < pats->n; j++)
+    {
+        bv_set(ends, pats->offset[j] + pattern_length(pats, j) - 1, 1);
+    }
+    return ends;
+}
+
+// MARK: Search
+enum report
+{
+    COUNT,   // number of matches per pattern
+    OFFSETS, // offset and pattern for each match
+    FIRST,   // offset and pattern of the first match, then stop
+};
+
+struct matcher
+{
+    struct patterns const *pats;
+    struct bv **pmask;
+    struct bv *ends;
+    struct bv_rank *end_rank; // maps an end bit to its pattern's index
+    struct bv *match;
+    size_t *counts;
+};
+
+// One step of the search: match = ((match & ~ends) << 1) | pmask[a], and
+// in the same pass over the words, report every pattern whose end bit
+// came out as zero. The state starts out as all ones, so a pattern can't
+// match before it has seen as many letters as it is long. Returns false if
+// we should stop.
+static bool step(struct matcher *mt, unsigned char a, size_t pos,
+                 enum report report, struct sao_out *out)
+{
+    uint64_t *state = mt->match->data;
+    uint64_t const *mask = mt->pmask[a]->data;
+    uint64_t const *ends = mt->ends->data;
+    size_t no_words = (mt->match->len + 63) / 64;
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < no_words; i++)
+    {
+        uint64_t u = state[i] & ~ends[i];
+        uint64_t w = (u << 1) | carry | mask[i];
+        carry = u >> 63;
+        state[i] = w;
+
+        for (uint64_t hits = ~w & ends[i]; hits; hits &= hits - 1)
+        {
+            size_t bit = 64 * i + (size_t)__builtin_ctzll(hits);
+            size_t j = bv_rank1(mt->end_rank, bit);
+            size_t m = pattern_length(mt->pats, j);
+
+            mt->counts[j]++;
+            if (report == COUNT)
+                continue;
+            sao_out_size(out, pos + 1 - m);
+            sao_out_char(out, '\t');
+            sao_out_size(out, j);
+            sao_out_char(out, '\n');
+            if (report == FIRST)
+                return false;
+        }
+    }
+    return true;
+}
+
+static int scan(enum report report, const char *patterns, const char *path)
+{
+    struct patterns pats;
+    if (!read_patterns(&pats, patterns))
+    {
+        perror(patterns);
+        return 1;
+    }
+    if (pats.n == 0)
+    {
+        fprintf(stderr, "No patterns in %s.\n", patterns);
+        free_patterns(&pats);
+        return 1;
+    }
+
+    struct sao_text text;
+    if (!sao_text_open(&text, path))
+    {
+        perror(path);
+        free_patterns(&pats);
+        return 1;
+    }
+    struct sao_out out;
+    sao_out_init(&out, STDOUT_FILENO);
+
+    struct matcher mt;
+    mt.pats = &pats;
+    mt.pmask = build_multi_pattern_masks(&pats);
+    mt.ends = build_end_mask(&pats);
+    mt.end_rank = bv_rank_new(mt.ends);
+    mt.match = bv_one(bv_new(pats.len));
+    mt.counts = calloc(pats.n, sizeof *mt.counts);
+    assert(mt.counts);
+
+    int status = 0;
+    size_t offset = 0;
+    const char *x;
+    for (size_t n; (n = sao_text_next(&text, &x)) > 0; offset += n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!step(&mt, (unsigned char)x[i], offset + i, report, &out))
+                goto done;
+        }
+    }
+    // A read error means we didn't see all of the text, so no counts.
+    status = sao_text_failed(&text, path) ? 1 : 0;
+    if (report == COUNT && status == 0)
+    {
+        for (size_t j = 0; j < pats.n; j++)
+        {
+            sao_out_size(&out, j);
+            sao_out_char(&out, '\t');
+            sao_out_size(&out, mt.counts[j]);
+            sao_out_char(&out, '\n');
+        }
+    }
+
+done:
+    sao_out_flush(&out);
+    if (sao_out_failed(&out))
+        status = 1;
+    free(mt.counts);
+    free(mt.match);
+    bv_rank_free(mt.end_rank);
+    free(mt.ends);
+    free_pattern_masks(mt.pmask);
+    sao_text_close(&text);
+    free_patterns(&pats);
+
+    return status;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s -c|-o|-f patterns [file]\n"
+            "\n"
+            "Searches the text in file (or stdin) for all the patterns in\n"
+            "the patterns file, one per line, and prints\n"
+            "  -c  the number of matches for each pattern\n"
+            "  -o  the offset and pattern number of every match\n"
+            "  -f  the offset and pattern number of the first match\n"
+            "Patterns are numbered from zero, skipping blank lines.\n",
+            prog);
+}
+
+int main(int argc, const char *argv[])
+{
+    if ((argc == 3 || argc == 4) && argv[1][0] == '-' && argv[1][1] && !argv[1][2])
+    {
+        const char *path = (argc == 4) ? argv[3] : NULL;
+        switch (argv[1][1])
+        {
+        case 'c':
+            return scan(COUNT, argv[2], path);
+        case 'o':
+            return scan(OFFSETS, argv[2], path);
+        case 'f':
+            return scan(FIRST, argv[2], path);
+        }
+    }
+
+    usage(argv[0]);
+    return 1;
+}
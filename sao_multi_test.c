@@ -0,0 +1,141 @@
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sao_multi -c, -o and -f against a brute-force search for each pattern,
+// with patterns of different lengths that share words of the state
+// vector, and some patterns repeated or suffixes of others.
+
+static const char *sao_multi; // the program, from the command line
+
+#define MAX_PATTERNS 40
+#define MAX_LEN 150
+
+struct patterns
+{
+    size_t n;
+    size_t len[MAX_PATTERNS];
+    char p[MAX_PATTERNS][MAX_LEN];
+};
+
+static void check(const char *x, size_t n, struct patterns const *pats)
+{
+    // One pattern per line, with blank lines and DOS line ends, which
+    // sao_multi skips.
+    char *file = malloc(pats->n * (MAX_LEN + 3));
+    assert(file); // We don't handle allocation errors
+    size_t len = 0;
+    for (size_t j = 0; j < pats->n; j++)
+    {
+        if (rng() % 8 == 0)
+            file[len++] = '\n';
+        memcpy(file + len, pats->p[j], pats->len[j]);
+        len += pats->len[j];
+        if (rng() % 8 == 0)
+            file[len++] = '\r';
+        file[len++] = '\n';
+    }
+    char *patterns_path = temp_file(file, len);
+    char *text_path = temp_file(x, n);
+
+    // The matches by where they end, and then by pattern.
+    size_t no = 0, *expected = malloc(2 * (n * pats->n + 1) * sizeof *expected);
+    size_t counts[MAX_PATTERNS] = {0};
+    assert(expected); // We don't handle allocation errors
+    for (size_t e = 0; e < n; e++)
+    {
+        for (size_t j = 0; j < pats->n; j++)
+        {
+            size_t m = pats->len[j];
+            if (m <= e + 1 && memcmp(x + e + 1 - m, pats->p[j], m) == 0)
+            {
+                expected[no++] = e + 1 - m;
+                expected[no++] = j;
+                counts[j]++;
+            }
+        }
+    }
+
+    size_t k, *got = run_tool(&k, "'%s' -o %s %s", sao_multi, patterns_path, text_path);
+    assert(k == no && memcmp(got, expected, no * sizeof *got) == 0);
+    free(got);
+    got = run_tool(&k, "cat %s | '%s' -c %s", text_path, sao_multi, patterns_path);
+    assert(k == 2 * pats->n);
+    for (size_t j = 0; j < pats->n; j++)
+        assert(got[2 * j] == j && got[2 * j + 1] == counts[j]);
+    free(got);
+    got = run_tool(&k, "'%s' -f %s %s", sao_multi, patterns_path, text_path);
+    assert(k == ((no > 0) ? 2 : 0) && memcmp(got, expected, k * sizeof *got) == 0);
+    free(got);
+
+    free(expected);
+    remove(text_path);
+    remove(patterns_path);
+    free(text_path);
+    free(patterns_path);
+    free(file);
+}
+
+static void random_string(char *x, size_t n, const char *alphabet, size_t letters)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = alphabet[rng() % letters];
+}
+
+static void test_random(void)
+{
+    size_t no_patterns[] = {1, 2, 5, MAX_PATTERNS};
+    size_t ns[] = {0, 5, 200, 2000, 3000};
+    const char *alphabets[] = {"ab", "acgt"};
+    for (size_t a = 0; a < sizeof alphabets / sizeof *alphabets; a++)
+    {
+        const char *alphabet = alphabets[a];
+        size_t letters = strlen(alphabet); // FlawFinder: ignore
+        for (size_t i = 0; i < sizeof no_patterns / sizeof *no_patterns; i++)
+        {
+            for (size_t j = 0; j < sizeof ns / sizeof *ns; j++)
+            {
+                size_t n = ns[j];
+                char *x = malloc(n + 1);
+                assert(x); // We don't handle allocation errors
+                random_string(x, n, alphabet, letters);
+
+                struct patterns pats;
+                pats.n = no_patterns[i];
+                for (size_t k = 0; k < pats.n; k++)
+                {
+                    // Short and long patterns, mostly from the text, and
+                    // now and then the previous one or a suffix of it.
+                    size_t m = 1 + rng() % ((rng() % 2) ? 8 : MAX_LEN);
+                    if (k > 0 && rng() % 6 == 0)
+                    {
+                        m = 1 + rng() % pats.len[k - 1];
+                        memcpy(pats.p[k], pats.p[k - 1] + pats.len[k - 1] - m, m);
+                    }
+                    else if (m <= n && rng() % 4 != 0)
+                        memcpy(pats.p[k], x + rng() % (n - m + 1), m);
+                    else
+                        random_string(pats.p[k], m, alphabet, letters);
+                    pats.len[k] = m;
+                }
+                check(x, n, &pats);
+                free(x);
+            }
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s path-to-sao_multi\n", argv[0]);
+        return 1;
+    }
+    sao_multi = argv[1];
+    test_random();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "sao_pmask.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+struct bv **alloc_pattern_masks(size_t m)
+{
+    // The table and all the vectors go in one block: the sigma pointers
+    // first, then the vectors one after another, so the masks are
+    // contiguous in memory and we only need a single malloc() and free().
+    size_t size = bv_size(m);
+    struct bv **pmask = malloc(sigma * sizeof *pmask + sigma * size);
+    assert(pmask); // We don't handle allocation errors
+
+    char *buf = (char *)(pmask + sigma);
+    for (size_t a = 0; a < sigma; a++)
+    {
+        // Table of all ones (bv_one() leaves the bits beyond m as zero)
+        pmask[a] = bv_one(bv_init(buf + a * size, m));
+    }
+
+    return pmask;
+}
+
+struct bv **build_pattern_masks(size_t m, const char p[m]) // FlawFinder: ignore
+{
+    struct bv **pmask = alloc_pattern_masks(m);
+
+    // Set matches to zero
+    for (size_t i = 0; i < m; i++)
+    {
+        // Set pmatch[a]'s i'th bit to 0 if there is an a
+        // at index i in the pattern.
+        bv_set(pmask[(unsigned char)p[i]], i, 0);
+    }
+
+    return pmask;
+}
+
+struct bv **build_bndm_masks(size_t m, const char p[m]) // FlawFinder: ignore
+{
+    struct bv **pmask = alloc_pattern_masks(m);
+    for (size_t a = 0; a < sigma; a++)
+    {
+        bv_zero(pmask[a]);
+    }
+    for (size_t i = 0; i < m; i++)
+    {
+        bv_set(pmask[(unsigned char)p[m - 1 - i]], i, 1);
+    }
+    return pmask;
+}
+
+// The rank table and no_masks all-ones vectors. The letters of p get the
+// ranks 0, 1, ... in the order they first appear, and the rest share the
+// next (unless p has all sigma letters).
+static struct compact_masks *alloc_compact_masks(size_t m, const char p[m]) // FlawFinder: ignore
+{
+    bool seen[sigma] = {false};
+    unsigned char rank[sigma];
+    size_t k = 0;
+    for (size_t i = 0; i < m; i++)
+    {
+        unsigned char a = (unsigned char)p[i];
+        if (!seen[a])
+        {
+            seen[a] = true;
+            rank[a] = (unsigned char)k++;
+        }
+    }
+    size_t no_masks = (k < sigma) ? k + 1 : k;
+
+    size_t size = bv_size(m);
+    size_t header = offsetof(struct compact_masks, masks) + no_masks * sizeof(struct bv *);
+    header = (header + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    struct compact_masks *cm = malloc(header + no_masks * size);
+    assert(cm); // We don't handle allocation errors
+
+    cm->no_masks = no_masks;
+    for (size_t a = 0; a < sigma; a++)
+    {
+        cm->rank[a] = seen[a] ? rank[a] : (unsigned char)k; // k < sigma if any letter is unseen
+    }
+    char *buf = (char *)cm + header;
+    for (size_t r = 0; r < no_masks; r++)
+    {
+        cm->masks[r] = bv_one(bv_init(buf + r * size, m));
+    }
+    return cm;
+}
+
+struct compact_masks *build_compact_masks(size_t m, const char p[m]) // FlawFinder: ignore
+{
+    struct compact_masks *cm = alloc_compact_masks(m, p);
+    for (size_t i = 0; i < m; i++)
+    {
+        bv_set(cm->masks[cm->rank[(unsigned char)p[i]]], i, 0);
+    }
+    return cm;
+}
+
+struct compact_masks *build_compact_bndm_masks(size_t m, const char p[m]) // FlawFinder: ignore
+{
+    struct compact_masks *cm = alloc_compact_masks(m, p);
+    for (size_t r = 0; r < cm->no_masks; r++)
+    {
+        bv_zero(cm->masks[r]);
+    }
+    for (size_t i = 0; i < m; i++)
+    {
+        bv_set(cm->masks[cm->rank[(unsigned char)p[m - 1 - i]]], i, 1);
+    }
+    return cm;
+}
+
+void free_pattern_masks(struct bv **pmask)
+{
+    free(pmask); // the vectors live in the same block as the table
+}
@@ -0,0 +1,47 @@
+#ifndef SAO_PMASK_H
+#define SAO_PMASK_H
+
+// The pattern masks for SHIFT-and-OR and the algorithms built on it.
+
+#include "bv.h"
+
+#ifndef sigma
+#define sigma 256 // size of alphabet (assumed one byte letters)
+#endif
+
+// A table of sigma all-ones vectors of length m, allocated as one block.
+// Free it with free_pattern_masks().
+struct bv **alloc_pattern_masks(size_t m);
+
+// One vector of length m per letter a, with bit i zero if p[i] == a and
+// one otherwise.
+struct bv **build_pattern_masks(size_t m, const char p[m]); // FlawFinder: ignore
+void free_pattern_masks(struct bv **pmask);
+
+// The masks for BNDM, which reads the window backwards: those of the
+// reversed pattern and with the opposite polarity, so bit i is one if
+// p[m - 1 - i] == a and zero otherwise. Free with free_pattern_masks().
+struct bv **build_bndm_masks(size_t m, const char p[m]); // FlawFinder: ignore
+
+// The same masks, but only for the letters in the pattern. All other
+// letters have the same mask (all ones for SHIFT-and-OR, all zeros for
+// BNDM), so they share one, and rank[a] is the index of a's mask in
+// masks. For DNA that is 5 vectors rather than 256, so even the masks
+// for a long pattern stay in cache. Allocated as one block; free with
+// free().
+struct compact_masks
+{
+    unsigned char rank[sigma];
+    size_t no_masks;
+    struct bv *masks[];
+};
+
+struct compact_masks *build_compact_masks(size_t m, const char p[m]);      // FlawFinder: ignore
+struct compact_masks *build_compact_bndm_masks(size_t m, const char p[m]); // FlawFinder: ignore
+
+static inline struct bv const *compact_mask(struct compact_masks const *cm, unsigned char a)
+{
+    return cm->masks[cm->rank[a]];
+}
+
+#endif // SAO_PMASK_H
@@ -4,6 +4,7 @@
 // is limited to 64).
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -0,0 +1,230 @@
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// sao -c, -o and -f against a brute-force search, with each algorithm,
+// for patterns in one word and longer, and on texts long enough to be
+// split into pieces that threads search in parallel, and read in chunks.
+
+static const char *sao; // the program, from the command line
+static const char *algorithms[] = {"shift", "bndm", "auto"};
+#define NO_ALGORITHMS (sizeof algorithms / sizeof *algorithms)
+
+static size_t *brute_force(const char *x, size_t n, const char *p, size_t m, size_t *no)
+{
+    size_t *hits = malloc((n + 1) * sizeof *hits);
+    assert(hits); // We don't handle allocation errors
+    *no = 0;
+    for (size_t i = 0; i + m <= n; i++)
+    {
+        if (memcmp(x + i, p, m) == 0)
+            hits[(*no)++] = i;
+    }
+    return hits;
+}
+
+static size_t *search(size_t *k, const char *mode, const char *opts, const char *algorithm,
+                      const char *pattern, const char *path, bool piped)
+{
+    if (piped)
+        return run_tool(k, "cat %s | '%s' %s %s -a %s %s",
+                        path, sao, mode, opts, algorithm, pattern);
+    return run_tool(k, "'%s' %s %s -a %s %s %s", sao, mode, opts, algorithm, pattern, path);
+}
+
+// Search x, which is in the file at path, with the options in opts, for
+// example a number of threads, and with the given algorithm or, if NULL,
+// each of them. If piped, sao reads the file from a pipe.
+static void check(const char *path, const char *x, size_t n, const char *p, size_t m,
+                  const char *opts, const char *algorithm, bool piped)
+{
+    char *pattern = malloc(m + 1);
+    assert(pattern); // We don't handle allocation errors
+    memcpy(pattern, p, m);
+    pattern[m] = '\0';
+    size_t no, k, *expected = brute_force(x, n, p, m, &no);
+
+    for (size_t a = 0; a < NO_ALGORITHMS; a++)
+    {
+        const char *alg = algorithm ? algorithm : algorithms[a];
+        size_t *got = search(&k, "-o", opts, alg, pattern, path, piped);
+        assert(k == no && memcmp(got, expected, no * sizeof *got) == 0);
+        free(got);
+        got = search(&k, "-c", opts, alg, pattern, path, piped);
+        assert(k == 1 && got[0] == no);
+        free(got);
+        got = search(&k, "-f", opts, alg, pattern, path, piped);
+        assert(k == (no > 0) && (no == 0 || got[0] == expected[0]));
+        free(got);
+        if (algorithm)
+            break;
+    }
+
+    free(expected);
+    free(pattern);
+}
+
+static void random_string(char *x, size_t n, const char *alphabet, size_t letters)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = alphabet[rng() % letters];
+}
+
+// Short texts, where each algorithm sees a single piece. The pattern
+// lengths are around the word sizes of the fixed-width vectors and the
+// switch to struct bv, with BNDM in one word up to 64.
+static void test_algorithms(void)
+{
+    size_t ms[] = {1, 2, 3, 7, 31, 32, 33, 63, 64, 65, 100, 128, 129,
+                   256, 257, 511, 512, 513, 1000};
+    const char *alphabets[] = {"ab", "acgt", "abcdefghijklmnopqrstuvwxyz"};
+    for (size_t a = 0; a < sizeof alphabets / sizeof *alphabets; a++)
+    {
+        const char *alphabet = alphabets[a];
+        size_t letters = strlen(alphabet); // FlawFinder: ignore
+        for (size_t i = 0; i < sizeof ms / sizeof *ms; i++)
+        {
+            size_t m = ms[i];
+            size_t ns[] = {m - 1, m, 3000};
+            for (size_t j = 0; j < sizeof ns / sizeof *ns; j++)
+            {
+                size_t n = ns[j];
+                char *x = malloc(n + 1), *p = malloc(m);
+                assert(x && p); // We don't handle allocation errors
+                random_string(x, n, alphabet, letters);
+                random_string(p, m, alphabet, letters);
+                if (rng() % 2 && n > 0)
+                {
+                    // A periodic text, where matches overlap and BNDM
+                    // reads every window to the end.
+                    size_t period = 1 + rng() % 4;
+                    for (size_t k = period; k < n; k++)
+                        x[k] = x[k - period];
+                }
+                if (n >= m)
+                {
+                    memcpy(p, x + rng() % (n - m + 1), m);
+                    // and sometimes a near miss
+                    if (rng() % 4 == 0)
+                        p[rng() % m] = alphabet[rng() % letters];
+                }
+
+                char *path = temp_file(x, n);
+                check(path, x, n, p, m, "-t 1", NULL, false);
+                remove(path);
+                free(path);
+                free(x);
+                free(p);
+            }
+        }
+    }
+}
+
+// Texts of several pieces of 1 MiB, with matches across the piece
+// boundaries, searched with several threads.
+static void test_pieces(void)
+{
+    size_t piece = (size_t)1 << 20, n = 3 * piece + piece / 2;
+    char *x = malloc(n);
+    assert(x); // We don't handle allocation errors
+    random_string(x, n, "acgt", 4);
+    char *p = malloc(1000);
+    assert(p); // We don't handle allocation errors
+
+    size_t ms[] = {3, 40, 64, 65, 300, 600};
+    for (size_t i = 0; i < sizeof ms / sizeof *ms; i++)
+    {
+        size_t m = ms[i];
+        random_string(p, m, "acgt", 4);
+        memcpy(x, p, m);
+        memcpy(x + n - m, p, m);
+        // Ending just before the second piece, at the start of the third,
+        // and halfway across into the fourth.
+        memcpy(x + piece - m, p, m);
+        memcpy(x + 2 * piece - m + 1, p, m);
+        memcpy(x + 3 * piece - m / 2, p, m);
+        char *path = temp_file(x, n);
+        check(path, x, n, p, m, "-t 4", NULL, false);
+        remove(path);
+        free(path);
+    }
+
+    free(p);
+    free(x);
+}
+
+// How the text is split: with one thread and more, where the first match
+// is in a later piece, and from a pipe, where the text comes in chunks of
+// 4 MiB. The text has matches only across the ends of the chunks and of
+// the pieces.
+static void test_threads(void)
+{
+    size_t chunk = (size_t)1 << 22, piece = (size_t)1 << 20, m = 40;
+    size_t n = 2 * chunk + chunk / 4;
+    char *x = malloc(n), p[40];
+    assert(x); // We don't handle allocation errors
+    random_string(x, n, "acgt", 4);
+    random_string(p, m, "acgt", 4);
+    memcpy(x + 3 * piece - m / 3, p, m);
+    memcpy(x + chunk - m / 2, p, m);
+    memcpy(x + 2 * chunk - m + 1, p, m);
+    char *path = temp_file(x, n);
+
+    unsigned threads[] = {1, 2, 3, 8};
+    for (size_t t = 0; t < sizeof threads / sizeof *threads; t++)
+    {
+        char opts[32];
+        snprintf(opts, sizeof opts, "-t %u", threads[t]);
+        check(path, x, n, p, m, opts, NULL, false);
+        check(path, x, n, p, m, opts, NULL, true);
+    }
+
+    remove(path);
+    free(path);
+    free(x);
+}
+
+// For patterns longer than 65536, a piece is 16 m rather than 1 MiB. A
+// match of such a pattern costs m^2 / 64 word operations, even with BNDM
+// (and SHIFT-and-OR on struct bv pays that for every character), so we
+// look for a single one, across the end of the second piece.
+static void test_long_pattern(void)
+{
+    size_t m = 70000, piece = 16 * m, n = 3 * piece;
+    char *x = malloc(n), *p = malloc(m + 1);
+    assert(x && p); // We don't handle allocation errors
+    random_string(x, n, "acgt", 4);
+    random_string(p, m, "acgt", 4);
+    p[m] = '\0';
+    memcpy(x + 2 * piece - m / 2, p, m);
+    char *path = temp_file(x, n);
+
+    size_t no, k, *expected = brute_force(x, n, p, m, &no);
+    size_t *got = run_tool(&k, "cat %s | '%s' -o -t 3 -a bndm %s", path, sao, p);
+    assert(k == no && memcmp(got, expected, no * sizeof *got) == 0);
+    free(got);
+    free(expected);
+
+    remove(path);
+    free(path);
+    free(p);
+    free(x);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s path-to-sao\n", argv[0]);
+        return 1;
+    }
+    sao = argv[1];
+    test_algorithms();
+    test_pieces();
+    test_threads();
+    test_long_pattern();
+    return 0;
+}
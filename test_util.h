@@ -0,0 +1,125 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Helpers shared by the tests and the benchmarks.
+
+#include "bv.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// A small deterministic generator (xorshift64), so failures can be
+// reproduced and benchmark runs compared.
+static uint64_t rng_state = 0x9e3779b97f4a7c15;
+static inline uint64_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// A vector of n random bits, a word at a time, with the bits beyond the
+// end zero.
+static inline struct bv *random_vector(size_t n)
+{
+    struct bv *v = bv_new(n);
+    for (size_t i = 0; i < (n + 63) / 64; i++)
+    {
+        v->data[i] = rng();
+    }
+    if (n % 64 != 0)
+        v->data[n / 64] &= ((uint64_t)1 << (n % 64)) - 1;
+    return v;
+}
+
+// MARK: Running the tools
+// The tests of the command line programs write the input to temporary
+// files, run the program through the shell and compare what it prints
+// with a brute-force answer.
+
+// A temporary file with the n bytes of data. Returns its name; remove()
+// the file and free() the name when done.
+static inline char *temp_file(const void *data, size_t n)
+{
+    char template[] = "/tmp/bv_tool_test_XXXXXX";
+    int fd = mkstemp(template);
+    assert(fd >= 0);
+    FILE *f = fdopen(fd, "wb");
+    assert(f);
+    size_t written = fwrite(data, 1, n, f);
+    assert(written == n);
+    int closed = fclose(f);
+    assert(closed == 0);
+
+    char *path = malloc(sizeof template);
+    assert(path); // We don't handle allocation errors
+    memcpy(path, template, sizeof template);
+    return path;
+}
+
+static inline char *vcommand(const char *fmt, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    assert(len >= 0);
+    char *cmd = malloc((size_t)len + 1);
+    assert(cmd); // We don't handle allocation errors
+    vsnprintf(cmd, (size_t)len + 1, fmt, args);
+    return cmd;
+}
+
+// Run the shell command fmt, printf() style, and return its exit status.
+static inline int run_status(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    char *cmd = vcommand(fmt, args);
+    va_end(args);
+    int status = system(cmd);
+    free(cmd);
+    return status;
+}
+
+// Run the shell command fmt, printf() style, which must succeed, and
+// return the numbers it printed, *n of them, in an array to free().
+static inline size_t *run_tool(size_t *n, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    char *cmd = vcommand(fmt, args);
+    va_end(args);
+
+    FILE *f = popen(cmd, "r");
+    assert(f);
+    size_t cap = 64;
+    size_t *x = malloc(cap * sizeof *x);
+    assert(x); // We don't handle allocation errors
+    *n = 0;
+    for (size_t y; fscanf(f, "%zu", &y) == 1;)
+    {
+        if (*n == cap)
+        {
+            cap *= 2;
+            x = realloc(x, cap * sizeof *x);
+            assert(x); // We don't handle allocation errors
+        }
+        x[(*n)++] = y;
+    }
+    assert(feof(f)); // nothing but numbers
+    int status = pclose(f);
+    if (status != 0)
+        fprintf(stderr, "Failed (%d): %s\n", status, cmd);
+    assert(status == 0);
+    free(cmd);
+    return x;
+}
+
+#endif // TEST_UTIL_H